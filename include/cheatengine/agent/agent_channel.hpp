@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace cheatengine {
+
+// Layout of the shared-memory segment between AgentClient and the injected
+// agent library. The client creates and initialises it; the agent maps the
+// same POSIX shm object by name. Only lock-free atomics are used, so the
+// segment works across the process boundary.
+//
+// One query is in flight at a time. The client fills the needle, then bumps
+// request_seq; the agent streams match addresses through the ring and
+// publishes complete_seq when it is done.
+struct AgentChannel {
+    static constexpr std::uint32_t magic_value = 0x43454147; // "CEAG"
+    static constexpr std::uint32_t version_value = 1;
+    static constexpr std::size_t max_needle = 256;
+    static constexpr std::size_t ring_capacity = 64 * 1024;
+
+    // Read by the agent library's load-time constructor.
+    static constexpr const char* channel_env = "CHEATENGINE_AGENT_CHANNEL";
+
+    enum State : std::uint32_t {
+        ABSENT = 0,
+        READY = 1,
+        STOPPED = 2
+    };
+
+    std::uint32_t magic{magic_value};
+    std::uint32_t version{version_value};
+    std::int32_t client_pid{0};
+    std::int32_t agent_pid{0};
+    std::atomic<std::uint32_t> state{ABSENT};
+    // Bumped by the agent while it is alive, idle or scanning.
+    std::atomic<std::uint64_t> heartbeat{0};
+
+    std::atomic<std::uint64_t> request_seq{0};
+    std::atomic<std::uint64_t> complete_seq{0};
+    std::atomic<std::uint32_t> cancel{0};
+    std::uint32_t needle_size{0};
+    std::uint8_t needle[max_needle]{};
+    std::atomic<std::uint64_t> bytes_scanned{0};
+
+    // Single producer (agent), single consumer (client); indices only grow.
+    std::atomic<std::uint64_t> head{0};
+    std::atomic<std::uint64_t> tail{0};
+    std::uint64_t ring[ring_capacity]{};
+};
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "agent channel needs lock-free 32-bit atomics");
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "agent channel needs lock-free 64-bit atomics");
+
+} // namespace cheatengine
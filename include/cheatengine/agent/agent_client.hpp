@@ -0,0 +1,69 @@
+#pragma once
+
+#include "cheatengine/agent/agent_channel.hpp"
+#include "cheatengine/memory/memory_scanner.hpp"
+#include "cheatengine/memory/value_types.hpp"
+
+#include <mach/mach.h>
+
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace cheatengine {
+
+// Controlling side of the in-process agent. launch() starts a target with
+// the agent library injected and a shared-memory channel to it; searches are
+// then run inside the target and only match addresses cross back. When the
+// agent is missing (dyld drops DYLD_INSERT_LIBRARIES for protected and
+// hardened-runtime binaries) or stops responding, search() falls back to the
+// remote scanner.
+//
+// The agent matches the target's memory in place. It re-checks each chunk
+// with mach_vm_region just before matching it, and a mapping torn down after
+// that check faults into a SIGSEGV/SIGBUS recovery point on the agent thread
+// instead of killing the target.
+//
+// DaemonServer's "launch" command starts targets through this class.
+class AgentClient {
+public:
+    // Longest silence from the agent before a query is abandoned.
+    static constexpr std::chrono::milliseconds stall_timeout{1000};
+
+    explicit AgentClient(std::string agent_library);
+    ~AgentClient();
+
+    AgentClient(const AgentClient&) = delete;
+    AgentClient& operator=(const AgentClient&) = delete;
+
+    // Spawns `executable` with `arguments` (argv[0] is the executable).
+    std::optional<pid_t> launch(const std::string& executable,
+        const std::vector<std::string>& arguments,
+        std::string& error);
+
+    [[nodiscard]] pid_t pid() const noexcept { return pid_; }
+    [[nodiscard]] bool connected() const;
+    // The agent reports ready from its load-time constructor, before main().
+    bool waitForAgent(std::chrono::milliseconds timeout) const;
+
+    // Returns false, leaving `results` as it was, when the query could not be
+    // answered in-process. A hit's context is the matched value alone, where
+    // a remote scan also includes up to context_bytes on either side.
+    bool searchInProcess(const SearchValue& value, MemoryScanner::ResultList& results);
+    // In-process when possible, otherwise a remote scan with `remote`.
+    MemoryScanner::ResultList search(const MemoryScanner& remote, task_t task, const SearchValue& value);
+
+private:
+    bool createChannel(std::string& error);
+    void destroyChannel();
+
+    std::string agent_library_;
+    std::string channel_name_;
+    AgentChannel* channel_{nullptr};
+    pid_t pid_{0};
+    std::mutex mutex_;
+};
+
+} // namespace cheatengine
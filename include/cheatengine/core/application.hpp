@@ -1,24 +1,33 @@
 #pragma once
 
+#include "cheatengine/core/thread_pool.hpp"
 #include "cheatengine/memory/memory_scanner.hpp"
 #include "cheatengine/monitor/value_monitor.hpp"
 #include "cheatengine/process/process_manager.hpp"
+#include "cheatengine/process/process_set.hpp"
 #include "cheatengine/writer/memory_writer.hpp"
 
 namespace cheatengine {
 
 class Application {
 public:
-    Application() = default;
+    Application()
+    {
+        process_manager_.setReadEngine(&memory_scanner_.readEngine());
+    }
 
     ProcessManager& processManager() { return process_manager_; }
+    ProcessSet& processSet() { return process_set_; }
     MemoryScanner& memoryScanner() { return memory_scanner_; }
     ValueMonitor& valueMonitor() { return value_monitor_; }
     MemoryWriter& memoryWriter() { return memory_writer_; }
+    ThreadPool& threadPool() { return thread_pool_; }
 
 private:
+    ThreadPool thread_pool_;
     ProcessManager process_manager_;
     MemoryScanner memory_scanner_;
+    ProcessSet process_set_{memory_scanner_, thread_pool_};
     ValueMonitor value_monitor_;
     MemoryWriter memory_writer_;
 };
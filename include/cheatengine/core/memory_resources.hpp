@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+namespace cheatengine {
+
+struct AllocationStats {
+    std::uint64_t allocations{0};
+    std::uint64_t deallocations{0};
+    std::uint64_t bytes_allocated{0};
+};
+
+// Forwards to an upstream resource and counts every request, so callers can
+// confirm that steady-state loops stop allocating.
+class CountingResource : public std::pmr::memory_resource {
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept;
+
+    [[nodiscard]] AllocationStats stats() const noexcept;
+    void resetStats() noexcept;
+    [[nodiscard]] std::pmr::memory_resource* upstream() const noexcept { return upstream_; }
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    std::pmr::memory_resource* upstream_;
+    std::atomic<std::uint64_t> allocations_{0};
+    std::atomic<std::uint64_t> deallocations_{0};
+    std::atomic<std::uint64_t> bytes_allocated_{0};
+};
+
+// Serves requests of at least `threshold` bytes straight from mach_vm_allocate,
+// asking for superpages first and falling back to regular pages when the
+// kernel refuses. Smaller requests go to the upstream resource.
+class HugePageResource : public std::pmr::memory_resource {
+public:
+    static constexpr std::size_t default_threshold = 2 * 1024 * 1024;
+
+    explicit HugePageResource(std::size_t threshold = default_threshold,
+        std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept;
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    std::size_t threshold_;
+    std::pmr::memory_resource* upstream_;
+};
+
+// Per-thread pool for short-lived read buffers. Memory obtained here must be
+// released on the same thread.
+std::pmr::memory_resource* threadBufferPool();
+
+// Process-wide HugePageResource with the default threshold.
+std::pmr::memory_resource* hugePageResource();
+
+} // namespace cheatengine
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "cheatengine/agent/agent_client.hpp"
+#include "cheatengine/core/application.hpp"
+#include "cheatengine/daemon/protocol.hpp"
+#include "cheatengine/memory/scan_handle.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cheatengine {
+
+// Long-running command server on a Unix domain socket. Attachments, region
+// maps, scan sessions and monitors stay resident between requests, so a
+// query only costs the work it actually does.
+//
+// Requests and responses are line-delimited JSON (see Request). Clients may
+// pipeline any number of requests; responses carry the request id. Searches
+// stream {"batch":[...]} lines as regions complete and end with a
+// {"done":true} line. Refines run off the event loop too, so their reply may
+// come after those of later requests.
+//
+// "regions" and "search" share a per-process region map that is reused for
+// region_cache_ttl; "refresh":true re-enumerates it first. A client's
+// sessions are dropped when it disconnects.
+//
+// "launch" starts an executable with the scan agent injected (see
+// AgentClient) and attaches to it; searches of that process then run inside
+// it, falling back to a remote scan when the agent did not load. Such a
+// search reports all its hits in one batch and is not interrupted by
+// "cancel".
+class DaemonServer {
+public:
+    // `agent_library` is the path injected into processes started by
+    // "launch".
+    DaemonServer(Application& app, std::string socket_path, std::string agent_library = {});
+    ~DaemonServer();
+
+    DaemonServer(const DaemonServer&) = delete;
+    DaemonServer& operator=(const DaemonServer&) = delete;
+
+    // Binds and listens; the socket is created with owner-only permissions.
+    // An existing socket file is only replaced when nothing answers on it;
+    // any other file at the path fails with "address in use".
+    bool start(std::string& error);
+    // Serves clients until stop() or a "shutdown" command.
+    void run();
+    // Safe to call from any thread or a signal handler.
+    void stop() noexcept;
+
+    static constexpr std::chrono::seconds region_cache_ttl{2};
+
+private:
+    struct Client {
+        std::uint64_t id{0};
+        int fd{-1};
+        std::string input;
+        std::string output;
+        bool closing{false};
+        // The peer shut down its sending side; queued replies and streamed
+        // batches are still delivered before the connection is closed.
+        bool read_closed{false};
+        // Searches and refines started by this client whose final line is
+        // not queued yet.
+        std::size_t jobs_running{0};
+    };
+
+    struct Session {
+        // Waits for a pool job still reading through the session.
+        ~Session();
+
+        std::uint64_t id{0};
+        pid_t pid{0};
+        std::size_t value_size{0};
+        std::uint64_t client_id{0};
+        std::string request_id;
+        std::mutex mutex;
+        MemoryScanner::ResultList results;
+        std::optional<ScanHandle> scan;
+        // A refine, or an in-process search, running on the pool.
+        std::future<void> job;
+        std::atomic<bool> job_cancelled{false};
+    };
+
+    struct CachedRegions {
+        std::vector<MemoryRegion> regions;
+        std::chrono::steady_clock::time_point taken{};
+    };
+
+    struct WorkerMessage {
+        std::uint64_t client_id{0};
+        std::uint64_t session_id{0};
+        std::string line;
+        // The session's done line is built when this is drained.
+        bool scan_complete{false};
+        // `line` is a refine's reply.
+        bool refine_complete{false};
+    };
+
+    using Handler = void (DaemonServer::*)(Client&, const Request&);
+
+    void acceptClients();
+    void readClient(Client& client);
+    void flushClient(Client& client);
+    void handleLine(Client& client, std::string_view line);
+
+    void postFromWorker(WorkerMessage message);
+    void drainWorkerMessages();
+    void wake() noexcept;
+
+    void reply(Client& client, std::string line);
+    void replyError(Client& client, const Request& request, std::string_view message);
+    std::optional<ProcessManager::ProcessInfo> requireProcess(Client& client, const Request& request);
+    Session* requireSession(Client& client, const Request& request);
+    const std::vector<MemoryRegion>& regionsFor(const ProcessManager::ProcessInfo& info, bool refresh);
+
+    void cmdPing(Client& client, const Request& request);
+    void cmdAttach(Client& client, const Request& request);
+    void cmdDetach(Client& client, const Request& request);
+    void cmdList(Client& client, const Request& request);
+    void cmdRegions(Client& client, const Request& request);
+    void cmdLaunch(Client& client, const Request& request);
+    void cmdSearch(Client& client, const Request& request);
+    void searchInAgent(Session& session, AgentClient& agent, task_t task, const SearchValue& value);
+    void cmdCancel(Client& client, const Request& request);
+    void cmdRefine(Client& client, const Request& request);
+    void cmdResults(Client& client, const Request& request);
+    void cmdDrop(Client& client, const Request& request);
+    void cmdRead(Client& client, const Request& request);
+    void cmdWatch(Client& client, const Request& request);
+    void cmdUnwatch(Client& client, const Request& request);
+    void cmdPoll(Client& client, const Request& request);
+    void cmdShutdown(Client& client, const Request& request);
+
+    Application& app_;
+    std::string socket_path_;
+    std::string agent_library_;
+    int listen_fd_{-1};
+    int wake_read_fd_{-1};
+    int wake_write_fd_{-1};
+    std::atomic<bool> running_{false};
+
+    std::map<std::uint64_t, Client> clients_;
+    std::uint64_t next_client_id_{1};
+
+    std::map<pid_t, CachedRegions> region_cache_;
+    std::map<pid_t, std::unique_ptr<AgentClient>> agents_;
+    std::map<pid_t, std::unique_ptr<ValueMonitor>> monitors_;
+    std::vector<std::uint8_t> read_buffer_;
+    std::vector<ValueMonitor::ValueChange> changes_;
+
+    std::mutex worker_mutex_;
+    std::vector<WorkerMessage> worker_messages_;
+
+    // Declared last so running scans are joined before anything they post to
+    // is torn down.
+    std::uint64_t next_session_id_{1};
+    std::map<std::uint64_t, std::unique_ptr<Session>> sessions_;
+};
+
+} // namespace cheatengine
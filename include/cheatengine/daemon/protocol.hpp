@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace cheatengine {
+
+// One request per line, as a flat JSON object whose values are strings,
+// numbers, booleans or null, e.g.
+//   {"id":7,"cmd":"search","pid":123,"type":"int32","value":100}
+// Addresses may be given as numbers or as "0x..." strings.
+class Request {
+public:
+    static std::optional<Request> parse(std::string_view line, std::string& error);
+
+    [[nodiscard]] bool has(const std::string& key) const { return fields_.count(key) != 0; }
+    [[nodiscard]] std::optional<std::string> string(const std::string& key) const;
+    [[nodiscard]] std::optional<std::int64_t> integer(const std::string& key) const;
+    [[nodiscard]] std::optional<std::uint64_t> address(const std::string& key) const;
+    [[nodiscard]] std::optional<double> number(const std::string& key) const;
+    [[nodiscard]] bool flag(const std::string& key) const;
+
+    // Raw JSON text of the "id" field so it can be echoed verbatim.
+    [[nodiscard]] const std::string& idJson() const noexcept { return id_json_; }
+
+private:
+    enum class Kind {
+        STRING,
+        NUMBER,
+        BOOLEAN,
+        NULL_VALUE
+    };
+
+    struct Field {
+        Kind kind{Kind::NULL_VALUE};
+        std::string text;
+    };
+
+    std::map<std::string, Field> fields_;
+    std::string id_json_{"null"};
+};
+
+// Builds one response line. Every response echoes the request id.
+class JsonWriter {
+public:
+    explicit JsonWriter(const std::string& id_json);
+
+    JsonWriter& field(std::string_view key, std::string_view value);
+    JsonWriter& field(std::string_view key, const char* value) { return field(key, std::string_view(value)); }
+    JsonWriter& field(std::string_view key, std::int64_t value);
+    JsonWriter& field(std::string_view key, std::uint64_t value);
+    JsonWriter& field(std::string_view key, double value);
+    JsonWriter& field(std::string_view key, bool value);
+    JsonWriter& hexField(std::string_view key, std::uint64_t value);
+    JsonWriter& rawField(std::string_view key, std::string_view json);
+
+    // Returns the finished line, newline included.
+    std::string finish();
+
+private:
+    void key(std::string_view name);
+
+    std::string out_;
+};
+
+void appendJsonString(std::string& out, std::string_view value);
+void appendHexAddress(std::string& out, std::uint64_t value);
+void appendHexBytes(std::string& out, const std::uint8_t* data, std::size_t size);
+
+} // namespace cheatengine
@@ -24,6 +24,8 @@ struct MemoryRegion {
     vm_prot_t protection{VM_PROT_NONE};
     std::string category;
     bool is_shared{false};
+    unsigned char share_mode{SM_EMPTY};
+    unsigned int pages_dirtied{0};
 
     ProtectionFlags flags() const { return ProtectionFlags::fromNative(protection); }
 };
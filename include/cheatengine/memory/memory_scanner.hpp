@@ -1,25 +1,133 @@
 #pragma once
 
+#include "cheatengine/core/memory_resources.hpp"
 #include "cheatengine/memory/memory_region.hpp"
+#include "cheatengine/memory/read_engine.hpp"
 #include "cheatengine/memory/value_types.hpp"
 
 #include <mach/mach.h>
 
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <optional>
 #include <vector>
 
 namespace cheatengine {
 
+class ScanHandle;
+
 class MemoryScanner {
 public:
     struct SearchResult {
         mach_vm_address_t address{0};
-        std::vector<std::uint8_t> context;
+        // The matched value plus up to context_bytes on either side. Agent
+        // hits (AgentClient) carry the matched value only.
+        std::pmr::vector<std::uint8_t> context;
         std::size_t value_size{0};
     };
 
+    using ResultList = std::pmr::vector<SearchResult>;
+    using ResultBatch = ResultList;
+    using BatchCallback = std::function<void(const ResultBatch&)>;
+
+    struct ScanOptions {
+        // When set, batches are delivered on the scan thread instead of being
+        // queued for ScanHandle::next().
+        BatchCallback on_batch;
+        // Invoked on the scan thread once the final status is visible
+        // through the handle.
+        std::function<void()> on_complete;
+        std::optional<std::chrono::steady_clock::time_point> deadline;
+        // Scans this region map instead of enumerating the task, for callers
+        // that keep one warm. Unreadable entries are skipped as usual.
+        std::optional<std::vector<MemoryRegion>> regions;
+        std::size_t max_batch_results{256};
+        std::chrono::milliseconds flush_interval{5};
+        // Batches and their contexts are allocated here; they are handed to
+        // the caller, so this must not be a per-scan arena.
+        std::pmr::memory_resource* result_resource{std::pmr::get_default_resource()};
+    };
+
+    // Holes inside a chunk are recovered page by page, so chunks can be large.
+    static constexpr mach_vm_size_t default_chunk_size = 64 * 1024;
+
+    struct Resources {
+        std::pmr::memory_resource* results{std::pmr::get_default_resource()};
+        // Chunk read buffers; nullptr selects the scanning thread's pool.
+        // With a chunk_size of HugePageResource::default_threshold or more,
+        // hugePageResource() backs each buffer with superpages.
+        std::pmr::memory_resource* buffers{nullptr};
+        // Bytes read per remote copy; rounded up to whole pages.
+        mach_vm_size_t chunk_size{default_chunk_size};
+    };
+
+    struct ScanStats {
+        std::uint64_t bytes_scanned{0};
+        std::size_t results{0};
+        AllocationStats buffer_allocations;
+        // Requests made to the result arena: list growth plus one per
+        // non-empty context.
+        AllocationStats result_allocations;
+    };
+
+    // Results together with the per-scan arena they were allocated from.
+    // Moving keeps the list valid; the arena is released with the object.
+    struct ScanResults {
+        std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+        ResultList results;
+    };
+
+    MemoryScanner() = default;
+    explicit MemoryScanner(Resources resources);
+
     std::vector<MemoryRegion> enumerate(task_t task) const;
-    std::vector<SearchResult> search(task_t task, const SearchValue& value) const;
+    // Allocates from a fresh monotonic arena over Resources::results.
+    ScanResults search(task_t task, const SearchValue& value) const;
+    // Results are allocated from `arena` (typically a per-scan
+    // std::pmr::monotonic_buffer_resource) and must not outlive it.
+    ResultList search(task_t task,
+        const SearchValue& value,
+        std::pmr::memory_resource* arena,
+        ScanStats* stats = nullptr) const;
+
+    // Scans a single region, appending hits to `results`. Safe to call
+    // concurrently from several threads.
+    void searchRegion(task_t task, const MemoryRegion& region, const SearchValue& value, ResultList& results) const;
+
+    // The scanner and the task port must outlive the returned handle.
+    ScanHandle searchAsync(task_t task, const SearchValue& value) const;
+    ScanHandle searchAsync(task_t task, const SearchValue& value, ScanOptions options) const;
+
     bool readChunk(task_t task, mach_vm_address_t address, std::size_t size, std::vector<std::uint8_t>& buffer) const;
+    bool readChunk(task_t task, mach_vm_address_t address, std::size_t size, std::pmr::vector<std::uint8_t>& buffer) const;
+
+    // Shared by every scan; enumerate() keeps its negative cache in step with
+    // the region map.
+    ReadEngine& readEngine() const { return read_engine_; }
+
+private:
+    friend class ScanHandle;
+
+    static constexpr std::size_t context_bytes = 16;
+
+    // Called after every chunk with the number of region bytes it consumed;
+    // returning false stops the region scan early.
+    using SliceCallback = std::function<bool(mach_vm_size_t)>;
+
+    bool scanRegion(task_t task,
+        const MemoryRegion& region,
+        const std::vector<std::uint8_t>& needle,
+        ReadEngine::Buffer& buffer,
+        ResultList& results,
+        const SliceCallback& on_slice,
+        AllocationStats* result_allocations = nullptr) const;
+
+    std::pmr::memory_resource* bufferResource() const;
+
+    Resources resources_;
+    mutable ReadEngine read_engine_;
 };
 
 } // namespace cheatengine
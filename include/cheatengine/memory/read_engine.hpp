@@ -0,0 +1,106 @@
+#pragma once
+
+#include "cheatengine/memory/memory_region.hpp"
+
+#include <mach/mach.h>
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+namespace cheatengine {
+
+// Remote reads that survive holes. A read that fails as a whole is split at
+// page boundaries until every readable byte has been recovered; pages that
+// still fail because they are unmapped or unreadable are remembered per task,
+// so later scans skip them without another trip into the kernel. Transient
+// failures are never cached. The cache is dropped whenever the task's region
+// map is seen to change.
+class ReadEngine {
+public:
+    // Beyond this many cached ranges a task's cache is reset rather than
+    // grown; a process that fragmented is better served by re-probing.
+    static constexpr std::size_t max_cached_ranges = 16384;
+
+    // A readable piece of the last read, relative to the start of the buffer.
+    struct Span {
+        std::size_t offset{0};
+        std::size_t size{0};
+    };
+
+    struct Buffer {
+        explicit Buffer(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : bytes(resource)
+            , spans(resource)
+        {
+        }
+
+        std::pmr::vector<std::uint8_t> bytes;
+        std::pmr::vector<Span> spans;
+    };
+
+    struct Stats {
+        std::uint64_t reads{0};
+        std::uint64_t split_reads{0};
+        std::uint64_t bytes_recovered{0};
+        std::uint64_t bytes_unreadable{0};
+        std::uint64_t cache_hits{0};
+        std::uint64_t invalidations{0};
+    };
+
+    ReadEngine();
+
+    ReadEngine(const ReadEngine&) = delete;
+    ReadEngine& operator=(const ReadEngine&) = delete;
+
+    // Reads [address, address + size) into `buffer.bytes` and lists the
+    // readable pieces in `buffer.spans`, in address order. Unreadable bytes
+    // are left unspecified. Returns the number of readable bytes.
+    std::size_t read(task_t task, mach_vm_address_t address, std::size_t size, Buffer& buffer);
+
+    // Records the task's current region map and drops its cache if the map
+    // differs from the one seen last time.
+    void observeRegions(task_t task, const std::vector<MemoryRegion>& regions);
+    void invalidate(task_t task);
+    void invalidateAll();
+
+    [[nodiscard]] bool knownUnreadable(task_t task, mach_vm_address_t address, std::size_t size) const;
+    [[nodiscard]] Stats stats() const noexcept;
+    // The host's VM page size; reads are split and cached at this size.
+    [[nodiscard]] mach_vm_size_t pageSize() const noexcept { return page_size_; }
+
+private:
+    struct TaskCache {
+        std::uint64_t fingerprint{0};
+        bool has_fingerprint{false};
+        // Unreadable ranges keyed by start, mapped to their end; ranges never
+        // overlap or touch.
+        std::map<mach_vm_address_t, mach_vm_address_t> unreadable;
+    };
+
+    void readPiece(task_t task, mach_vm_address_t base, mach_vm_address_t address, mach_vm_size_t size, Buffer& buffer);
+    bool nextUnreadable(task_t task,
+        mach_vm_address_t from,
+        mach_vm_address_t end,
+        mach_vm_address_t& skip_start,
+        mach_vm_address_t& skip_end) const;
+    void markUnreadable(task_t task, mach_vm_address_t start, mach_vm_address_t end);
+
+    mach_vm_size_t page_size_;
+    mach_vm_address_t page_mask_;
+    std::map<task_t, TaskCache> caches_;
+    std::atomic<std::size_t> cached_ranges_{0};
+    mutable std::mutex mutex_;
+
+    std::atomic<std::uint64_t> reads_{0};
+    std::atomic<std::uint64_t> split_reads_{0};
+    std::atomic<std::uint64_t> bytes_recovered_{0};
+    std::atomic<std::uint64_t> bytes_unreadable_{0};
+    std::atomic<std::uint64_t> cache_hits_{0};
+    std::atomic<std::uint64_t> invalidations_{0};
+};
+
+} // namespace cheatengine
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "cheatengine/memory/memory_scanner.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <optional>
+
+namespace cheatengine {
+
+class ScanHandle {
+public:
+    enum class Status {
+        RUNNING,
+        COMPLETED,
+        CANCELLED,
+        DEADLINE_EXCEEDED,
+        // The scan or an on_batch callback threw; see error().
+        FAILED
+    };
+
+    struct Progress {
+        std::uint64_t bytes_scanned{0};
+        std::uint64_t bytes_total{0};
+        std::size_t regions_completed{0};
+        std::size_t regions_total{0};
+        std::size_t results_found{0};
+        AllocationStats buffer_allocations;
+    };
+
+    ScanHandle(ScanHandle&&) noexcept = default;
+    ScanHandle& operator=(ScanHandle&& other) noexcept;
+    ScanHandle(const ScanHandle&) = delete;
+    ScanHandle& operator=(const ScanHandle&) = delete;
+    ~ScanHandle();
+
+    // Blocks until a queued batch is available; returns nullopt once the scan
+    // has finished and the queue is drained. Scans started with an on_batch
+    // callback never queue, so next() only waits for completion.
+    std::optional<MemoryScanner::ResultBatch> next();
+    std::optional<MemoryScanner::ResultBatch> tryNext();
+
+    void cancel() noexcept;
+    Status wait();
+    bool waitFor(std::chrono::milliseconds timeout);
+
+    [[nodiscard]] Status status() const;
+    [[nodiscard]] Progress progress() const;
+    // The exception that ended a FAILED scan, or one thrown by on_complete.
+    [[nodiscard]] std::exception_ptr error() const;
+
+private:
+    friend class MemoryScanner;
+
+    struct State;
+
+    static ScanHandle start(const MemoryScanner& scanner,
+        task_t task,
+        const SearchValue& value,
+        MemoryScanner::ScanOptions options);
+
+    explicit ScanHandle(std::shared_ptr<State> state);
+
+    void release() noexcept;
+
+    std::shared_ptr<State> state_;
+};
+
+} // namespace cheatengine
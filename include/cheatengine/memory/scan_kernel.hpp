@@ -0,0 +1,34 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace cheatengine {
+
+// The match loop shared by the remote scanner and the in-process agent.
+// Calls `on_match(offset)` for every occurrence of the needle in
+// [begin, end), overlapping occurrences included, in ascending order, until
+// it returns false.
+template <typename OnMatch>
+void forEachMatch(const std::uint8_t* begin,
+    const std::uint8_t* end,
+    const std::uint8_t* needle,
+    std::size_t needle_size,
+    OnMatch&& on_match)
+{
+    if (needle_size == 0 || static_cast<std::size_t>(end - begin) < needle_size) {
+        return;
+    }
+
+    const std::uint8_t* needle_end = needle + needle_size;
+    const std::uint8_t* it = std::search(begin, end, needle, needle_end);
+    while (it != end) {
+        if (!on_match(static_cast<std::size_t>(it - begin))) {
+            return;
+        }
+        it = std::search(it + 1, end, needle, needle_end);
+    }
+}
+
+} // namespace cheatengine
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "cheatengine/memory/memory_region.hpp"
+
+#include <mach/mach.h>
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace cheatengine {
+
+// Watches whole regions instead of single addresses. Each poll hashes every
+// page; only pages whose hash moved are diffed word by word against the
+// previous snapshot to produce candidate addresses.
+class RegionMonitor {
+public:
+    struct PageHeat {
+        mach_vm_address_t address{0};
+        std::uint32_t change_count{0};
+        std::chrono::steady_clock::time_point last_change{};
+    };
+
+    struct Candidate {
+        mach_vm_address_t address{0};
+        std::uint64_t old_value{0};
+        std::uint64_t new_value{0};
+    };
+
+    struct PassResult {
+        std::size_t pages_hashed{0};
+        std::size_t pages_changed{0};
+        std::vector<Candidate> candidates;
+    };
+
+    // `word_size` (1, 2, 4 or 8) is the granularity of candidate addresses.
+    explicit RegionMonitor(std::size_t word_size = 4);
+
+    void addRegion(const MemoryRegion& region);
+    void removeRegion(mach_vm_address_t start_address);
+    void clear();
+
+    // The first pass over a region only records its baseline.
+    PassResult poll(task_t task);
+
+    // Pages changed at least `min_changes` times, hottest first.
+    std::vector<PageHeat> heatmap(std::uint32_t min_changes = 1) const;
+    void resetCounters();
+
+    // The host's VM page size; pages are hashed and counted at this size.
+    [[nodiscard]] std::size_t pageSize() const noexcept { return page_size_; }
+
+    static std::uint64_t hashPage(const std::uint8_t* data, std::size_t size) noexcept;
+
+private:
+    struct WatchedRegion {
+        MemoryRegion region;
+        std::vector<std::uint8_t> snapshot;
+        std::vector<std::uint64_t> hashes;
+        std::vector<std::uint32_t> change_counts;
+        std::vector<std::chrono::steady_clock::time_point> last_change;
+        std::vector<bool> valid;
+    };
+
+    void pollRegion(task_t task, WatchedRegion& watched, PassResult& result);
+    void diffPage(const WatchedRegion& watched, std::size_t page, const std::uint8_t* current, std::size_t size, PassResult& result) const;
+
+    std::size_t word_size_;
+    std::size_t page_size_;
+    std::vector<WatchedRegion> regions_;
+    std::vector<std::uint8_t> buffer_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace cheatengine
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "cheatengine/memory/value_types.hpp"
+
+#include <mach/mach.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace cheatengine {
+
+// Per-address sample history, compressed the way Gorilla does it: timestamps
+// as delta-of-delta at microsecond resolution and values as the XOR against
+// the previous sample, so a steadily sampled value that rarely changes costs
+// a couple of bits per sample. Each series is a run of fixed-size chunks;
+// retention only ever drops whole chunks from the front.
+class TimeSeriesStore {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::size_t chunk_bytes = 1024;
+
+    struct Retention {
+        // Chunks whose newest sample is older than this are dropped.
+        std::chrono::seconds max_age{3600};
+        // Upper bound on chunks kept per series; 0 means unlimited.
+        std::size_t max_chunks{0};
+    };
+
+    // `bits` holds the value's raw bytes, zero-extended to 64 bits.
+    struct Sample {
+        Clock::time_point timestamp{};
+        std::uint64_t bits{0};
+    };
+
+    struct Bucket {
+        Clock::time_point start{};
+        std::size_t count{0};
+        double min{0.0};
+        double max{0.0};
+        double mean{0.0};
+        double last{0.0};
+    };
+
+    struct Stats {
+        std::size_t series{0};
+        std::size_t chunks{0};
+        std::uint64_t samples{0};
+        // Bits actually written, rounded up to bytes.
+        std::uint64_t encoded_bytes{0};
+        // Chunk storage held, including the unused tail of open chunks.
+        std::uint64_t reserved_bytes{0};
+    };
+
+    TimeSeriesStore();
+    explicit TimeSeriesStore(Retention retention);
+
+    // Declares how a series' samples are interpreted by downsample(). Series
+    // created implicitly by append() are treated as signed integers.
+    bool addSeries(mach_vm_address_t address, ValueType type);
+    void removeSeries(mach_vm_address_t address);
+    void clear();
+    [[nodiscard]] bool contains(mach_vm_address_t address) const;
+
+    // `size` must be 1, 2, 4 or 8 and stay the same for the life of the
+    // series. Returns false, storing nothing, for a sample older than the
+    // newest one in the series; callers merging several sources must order
+    // them first.
+    bool append(mach_vm_address_t address, Clock::time_point timestamp, const std::uint8_t* data, std::size_t size);
+
+    // Samples with from <= timestamp <= to, oldest first.
+    std::vector<Sample> range(mach_vm_address_t address, Clock::time_point from, Clock::time_point to) const;
+    // Aggregates [from, to] into buckets of `step`; empty buckets are omitted.
+    std::vector<Bucket> downsample(mach_vm_address_t address,
+        Clock::time_point from,
+        Clock::time_point to,
+        Clock::duration step) const;
+
+    // Retention is applied on every chunk rollover; this also trims series
+    // that have stopped receiving samples.
+    void enforceRetention(Clock::time_point now);
+    [[nodiscard]] Stats stats() const;
+
+    static double toDouble(ValueType type, std::size_t size, std::uint64_t bits) noexcept;
+
+private:
+    static constexpr std::size_t chunk_words = chunk_bytes / sizeof(std::uint64_t);
+
+    struct Chunk {
+        std::int64_t first_time{0};
+        std::int64_t last_time{0};
+        std::uint32_t count{0};
+        std::size_t bit_count{0};
+        std::array<std::uint64_t, chunk_words> words{};
+    };
+
+    struct Series {
+        ValueType type{ValueType::INT64};
+        std::size_t size{0};
+        // Oldest first. Chunks are held by pointer so dropping from the
+        // front only shifts pointers.
+        std::vector<std::unique_ptr<Chunk>> chunks;
+        // Encoder state for the newest chunk.
+        std::int64_t previous_time{0};
+        std::int64_t previous_delta{0};
+        std::uint64_t previous_bits{0};
+        unsigned previous_leading{0};
+        unsigned previous_trailing{0};
+        bool has_window{false};
+    };
+
+    void appendLocked(Series& series, std::int64_t time, std::uint64_t bits);
+    void trimLocked(Series& series, std::int64_t now) const;
+    template <typename Visitor>
+    void decodeLocked(const Series& series, std::int64_t from, std::int64_t to, Visitor&& visit) const;
+
+    Retention retention_;
+    std::map<mach_vm_address_t, Series> series_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace cheatengine
@@ -1,8 +1,15 @@
 #pragma once
 
+#include "cheatengine/core/memory_resources.hpp"
+#include "cheatengine/monitor/region_monitor.hpp"
+#include "cheatengine/monitor/time_series.hpp"
+#include "cheatengine/monitor/watchpoint_monitor.hpp"
+
 #include <mach/mach.h>
 
 #include <chrono>
+#include <memory>
+#include <memory_resource>
 #include <mutex>
 #include <optional>
 #include <vector>
@@ -14,24 +21,73 @@ public:
     struct MonitoredAddress {
         mach_vm_address_t address{0};
         std::size_t value_size{0};
-        std::vector<std::uint8_t> last_value;
+        std::pmr::vector<std::uint8_t> last_value;
         std::chrono::steady_clock::time_point last_update{};
+        bool hardware_watched{false};
     };
 
     struct ValueChange {
         mach_vm_address_t address{0};
-        std::vector<std::uint8_t> old_value;
-        std::vector<std::uint8_t> new_value;
+        std::pmr::vector<std::uint8_t> old_value;
+        std::pmr::vector<std::uint8_t> new_value;
         std::chrono::steady_clock::time_point timestamp{};
+        // Only known for changes captured by a hardware watchpoint. Data
+        // breakpoints trap after the store retires, so this is the
+        // instruction following the write, not the write itself.
+        std::uint64_t instruction_pointer{0};
+        std::uint64_t thread_id{0};
     };
 
+    ValueMonitor() = default;
+    explicit ValueMonitor(std::pmr::memory_resource* resource);
+
     void addAddress(mach_vm_address_t address, std::size_t size);
     void removeAddress(mach_vm_address_t address);
-    std::vector<ValueChange> poll(task_t task);
+    // Change payloads are allocated from `resource`, not the monitor's, so
+    // they stay valid after the monitor is gone.
+    std::vector<ValueChange> poll(task_t task,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    // Clears `changes` and refills it, keeping its capacity; a poll in which
+    // nothing changed performs no allocations.
+    void poll(task_t task,
+        std::vector<ValueChange>& changes,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource());
     std::vector<MonitoredAddress> tracked() const;
 
+    // Switches up to WatchpointMonitor::max_watchpoints eligible addresses to
+    // debug-register watchpoints; every write to them is then reported by
+    // poll(), including writes that store the same value. Remaining addresses
+    // keep being polled. Returns false when watchpoints are unavailable.
+    bool enableWatchpoints(task_t task);
+    void disableWatchpoints();
+    [[nodiscard]] bool watchpointsEnabled() const;
+
+    // Region-level mode: page heatmap plus candidate addresses for pages
+    // that changed between passes.
+    RegionMonitor& regions() noexcept { return regions_; }
+    const RegionMonitor& regions() const noexcept { return regions_; }
+    // Starts tracking the candidates of a region pass as single addresses.
+    void watchCandidates(const RegionMonitor::PassResult& pass, std::size_t value_size);
+
+    // Every sample read by poll(), changed or not, and every watchpoint
+    // write is appended to `history` under the sampled address. The store is
+    // not owned; pass nullptr to stop recording.
+    void setHistory(TimeSeriesStore* history);
+
+    [[nodiscard]] AllocationStats allocationStats() const noexcept { return resource_.stats(); }
+
 private:
+    void addAddressLocked(mach_vm_address_t address, std::size_t size);
+    void armAvailableLocked();
+    void collectWatchpointEventsLocked(std::vector<ValueChange>& changes, std::pmr::memory_resource* resource);
+
+    CountingResource resource_;
     std::vector<MonitoredAddress> addresses_;
+    std::pmr::vector<std::uint8_t> scratch_{&resource_};
+    RegionMonitor regions_;
+    std::unique_ptr<WatchpointMonitor> watchpoints_;
+    std::vector<WatchpointMonitor::WriteEvent> events_;
+    TimeSeriesStore* history_{nullptr};
     mutable std::mutex mutex_;
 };
 
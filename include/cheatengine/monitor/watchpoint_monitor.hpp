@@ -0,0 +1,88 @@
+#pragma once
+
+#include <mach/mach.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cheatengine {
+
+// Arms the x86-64 debug registers (DR0-DR3) of every thread in a task as
+// write watchpoints and collects a WriteEvent each time one fires. Events are
+// delivered through a Mach exception port that replaces the task's
+// EXC_BREAKPOINT handler while the monitor is running.
+class WatchpointMonitor {
+public:
+    static constexpr std::size_t max_watchpoints = 4;
+
+    struct WriteEvent {
+        mach_vm_address_t address{0};
+        std::size_t size{0};
+        std::array<std::uint8_t, 8> value{};
+        // The writer's RIP when the trap was taken: the instruction after
+        // the store.
+        std::uint64_t instruction_pointer{0};
+        std::uint64_t thread_id{0};
+        std::chrono::steady_clock::time_point timestamp{};
+    };
+
+    WatchpointMonitor() = default;
+    ~WatchpointMonitor();
+
+    WatchpointMonitor(const WatchpointMonitor&) = delete;
+    WatchpointMonitor& operator=(const WatchpointMonitor&) = delete;
+
+    [[nodiscard]] static bool supported() noexcept;
+    // Debug registers only cover naturally aligned 1, 2, 4 or 8 byte ranges.
+    [[nodiscard]] static bool canWatch(mach_vm_address_t address, std::size_t size) noexcept;
+
+    bool start(task_t task);
+    void stop();
+    [[nodiscard]] bool running() const noexcept { return running_.load(); }
+
+    bool arm(mach_vm_address_t address, std::size_t size);
+    void disarm(mach_vm_address_t address);
+    [[nodiscard]] bool isArmed(mach_vm_address_t address) const;
+    [[nodiscard]] std::size_t freeSlots() const;
+
+    // Moves all pending events into `events`, oldest first.
+    void drain(std::vector<WriteEvent>& events);
+
+private:
+    struct Slot {
+        mach_vm_address_t address{0};
+        std::size_t size{0};
+        bool active{false};
+    };
+
+    struct SavedHandlers {
+        mach_msg_type_number_t count{0};
+        std::array<exception_mask_t, EXC_TYPES_COUNT> masks{};
+        std::array<mach_port_t, EXC_TYPES_COUNT> ports{};
+        std::array<exception_behavior_t, EXC_TYPES_COUNT> behaviors{};
+        std::array<thread_state_flavor_t, EXC_TYPES_COUNT> flavors{};
+    };
+
+    void listen();
+    // Records an event for each of our slots the thread's DR6 reports as
+    // hit; returns false when none is, leaving DR6 untouched.
+    bool handleException(mach_port_t thread);
+    void applyDebugState();
+    void applyDebugStateLocked();
+
+    task_t task_{MACH_PORT_NULL};
+    mach_port_t exception_port_{MACH_PORT_NULL};
+    SavedHandlers saved_;
+    std::array<Slot, max_watchpoints> slots_{};
+    std::vector<WriteEvent> events_;
+    mutable std::mutex mutex_;
+    std::atomic<bool> running_{false};
+    std::thread listener_;
+};
+
+} // namespace cheatengine
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <mach/mach.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace cheatengine {
+
+// Maps addresses in a task to module + offset and back, so addresses survive
+// ASLR across restarts. Modules come from dyld's image list, which also
+// covers dylibs that live only in the shared cache; each module is keyed by
+// its LC_UUID. Symbol tables are parsed from the image's __LINKEDIT at most
+// once per UUID and persisted in `cache_directory`, so a restarted target
+// re-resolves without touching its symbol tables again.
+class ModuleIndex {
+public:
+    struct Symbol {
+        std::string name;
+        // Relative to the module's Mach-O header.
+        std::uint64_t offset{0};
+        std::uint64_t size{0};
+    };
+
+    struct SymbolTable {
+        std::vector<Symbol> symbols; // sorted by offset
+        std::unordered_map<std::string, std::size_t> by_name;
+    };
+
+    struct Module {
+        std::string path;
+        std::string name;
+        std::string build_id;
+        mach_vm_address_t base{0};
+        mach_vm_size_t size{0};
+    };
+
+    // A task-independent address. An empty build_id matches any module with
+    // the same name.
+    struct Location {
+        std::string module;
+        std::string build_id;
+        std::uint64_t offset{0};
+
+        // "libfoo.dylib+0x1a2b"
+        std::string toString() const;
+        static std::optional<Location> parse(std::string_view text);
+    };
+
+    // Holds a copy: tables of modules without an LC_UUID are not kept.
+    struct SymbolHit {
+        Symbol symbol;
+        std::uint64_t displacement{0};
+    };
+
+    // ~/Library/Caches/cheatengine/symbols
+    static std::string defaultCacheDirectory();
+
+    ModuleIndex();
+    // An empty directory disables the on-disk cache.
+    explicit ModuleIndex(std::string cache_directory);
+
+    ModuleIndex(const ModuleIndex&) = delete;
+    ModuleIndex& operator=(const ModuleIndex&) = delete;
+
+    // Replaces the module list with the task's current images. Parsed symbol
+    // tables are kept, keyed by build ID, across builds and tasks. Safe to run
+    // alongside symbolize() and resolveSymbol(); the other lookups return
+    // references into the module list and must not overlap it.
+    bool build(task_t task);
+    [[nodiscard]] const std::vector<Module>& modules() const noexcept { return modules_; }
+
+    [[nodiscard]] std::optional<Location> locate(mach_vm_address_t address) const;
+    [[nodiscard]] std::optional<mach_vm_address_t> resolve(const Location& location) const;
+    [[nodiscard]] const Module* moduleFor(mach_vm_address_t address) const;
+    [[nodiscard]] const Module* findModule(std::string_view name, std::string_view build_id = {}) const;
+
+    // Nearest symbol at or below `address`; loads the module's table on
+    // first use.
+    std::optional<SymbolHit> symbolize(mach_vm_address_t address);
+    std::optional<mach_vm_address_t> resolveSymbol(std::string_view module, std::string_view symbol);
+
+private:
+    // A mapped segment; __LINKEDIT is left out because shared-cache images
+    // all point at the same one.
+    struct Range {
+        mach_vm_address_t start{0};
+        mach_vm_address_t end{0};
+        std::size_t module{0};
+    };
+
+    struct ImageLayout {
+        std::uint64_t text_vmaddr{0};
+        std::uint64_t linkedit_vmaddr{0};
+        std::uint64_t linkedit_fileoff{0};
+        std::uint32_t symoff{0};
+        std::uint32_t nsyms{0};
+        std::uint32_t stroff{0};
+        std::uint32_t strsize{0};
+        bool has_symtab{false};
+    };
+
+    bool addImage(task_t task, mach_vm_address_t header_address, std::string path);
+    // symbolsFor() and parseSymbols() expect symbols_mutex_ to be held.
+    std::shared_ptr<const SymbolTable> symbolsFor(std::size_t module);
+    // Returns nullptr if the image's symbol table could not be read.
+    std::shared_ptr<SymbolTable> parseSymbols(std::size_t module) const;
+    std::shared_ptr<SymbolTable> loadCached(const std::string& build_id) const;
+    void storeCached(const std::string& build_id, const SymbolTable& table) const;
+
+    std::string cache_directory_;
+    task_t task_{MACH_PORT_NULL};
+    std::vector<Module> modules_;
+    std::vector<ImageLayout> layouts_;
+    std::vector<Range> ranges_;
+    std::multimap<std::string, std::size_t, std::less<>> by_name_;
+    std::map<std::string, std::shared_ptr<const SymbolTable>, std::less<>> symbol_tables_;
+    // Guards the module list against build() and the parsed-table cache.
+    std::mutex symbols_mutex_;
+};
+
+} // namespace cheatengine
@@ -7,6 +7,8 @@
 
 namespace cheatengine {
 
+class ReadEngine;
+
 class ProcessManager {
 public:
     struct ProcessInfo {
@@ -18,6 +20,9 @@ public:
 
     bool attach(pid_t pid);
     void detach();
+    // The engine's cache for the task is dropped on detach, since the port
+    // name may be handed out again by the next attach. Not owned.
+    void setReadEngine(ReadEngine* engine) noexcept { read_engine_ = engine; }
     [[nodiscard]] std::optional<ProcessInfo> currentProcess() const noexcept;
     [[nodiscard]] bool ownsProcess(pid_t pid) const;
 
@@ -26,6 +31,7 @@ private:
     void resetState();
 
     ProcessInfo process_;
+    ReadEngine* read_engine_{nullptr};
 };
 
 } // namespace cheatengine
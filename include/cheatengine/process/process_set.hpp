@@ -0,0 +1,62 @@
+#pragma once
+
+#include "cheatengine/core/thread_pool.hpp"
+#include "cheatengine/memory/memory_scanner.hpp"
+#include "cheatengine/process/process_manager.hpp"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace cheatengine {
+
+// Attaches to several processes at once and runs one query across all of
+// them on a shared thread pool.
+class ProcessSet {
+public:
+    struct ProcessResults {
+        pid_t pid{0};
+        MemoryScanner::ResultList results;
+        std::uint64_t bytes_scanned{0};
+        std::size_t regions_scanned{0};
+        // Unmodified shared file-backed regions whose hits were taken from
+        // an identical mapping already scanned in another process.
+        std::size_t regions_deduplicated{0};
+    };
+
+    ProcessSet(const MemoryScanner& scanner, ThreadPool& pool);
+    ~ProcessSet();
+
+    ProcessSet(const ProcessSet&) = delete;
+    ProcessSet& operator=(const ProcessSet&) = delete;
+
+    bool attach(pid_t pid);
+    // Attaches to every user-owned process whose executable path matches;
+    // returns the number of newly attached processes.
+    std::size_t attachByPath(const std::string& executable_path);
+    void detach(pid_t pid);
+    void detachAll();
+
+    [[nodiscard]] std::vector<ProcessManager::ProcessInfo> processes() const;
+    [[nodiscard]] std::optional<ProcessManager::ProcessInfo> find(pid_t pid) const;
+    [[nodiscard]] std::size_t size() const;
+
+    std::vector<ProcessResults> search(const SearchValue& value);
+
+private:
+    // Detaches when the last reference goes away; search() holds one for each
+    // target so a concurrent detach cannot release a port mid-scan.
+    struct Attachment;
+
+    std::vector<std::shared_ptr<Attachment>> attachments() const;
+
+    const MemoryScanner& scanner_;
+    ThreadPool& pool_;
+    std::map<pid_t, std::shared_ptr<Attachment>> managers_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace cheatengine
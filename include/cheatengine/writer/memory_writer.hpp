@@ -1,8 +1,11 @@
 #pragma once
 
+#include "cheatengine/core/memory_resources.hpp"
+
 #include <mach/mach.h>
 
 #include <chrono>
+#include <memory_resource>
 #include <mutex>
 #include <vector>
 
@@ -12,20 +15,28 @@ class MemoryWriter {
 public:
     struct WriteOperation {
         mach_vm_address_t address{0};
-        std::vector<std::uint8_t> old_value;
-        std::vector<std::uint8_t> new_value;
+        std::pmr::vector<std::uint8_t> old_value;
+        std::pmr::vector<std::uint8_t> new_value;
         std::chrono::steady_clock::time_point timestamp{};
         bool success{false};
     };
 
+    MemoryWriter() = default;
+    // History payloads are allocated from `resource`; since history only
+    // grows, a std::pmr::monotonic_buffer_resource is a good fit.
+    explicit MemoryWriter(std::pmr::memory_resource* resource);
+
     bool write(task_t task, mach_vm_address_t address, const std::vector<std::uint8_t>& data);
     bool canWrite(task_t task, mach_vm_address_t address, std::size_t size) const;
     std::vector<WriteOperation> history() const;
 
+    [[nodiscard]] AllocationStats allocationStats() const noexcept { return resource_.stats(); }
+
 private:
     void recordOperation(WriteOperation operation);
 
-    std::vector<WriteOperation> history_;
+    CountingResource resource_;
+    std::pmr::vector<WriteOperation> history_{&resource_};
     mutable std::mutex mutex_;
 };
 
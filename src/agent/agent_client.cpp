@@ -0,0 +1,248 @@
+#include "cheatengine/agent/agent_client.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <thread>
+
+extern char** environ;
+
+namespace {
+
+constexpr const char* insert_libraries_env = "DYLD_INSERT_LIBRARIES";
+
+std::atomic<unsigned> channel_counter{0};
+
+bool startsWith(const char* entry, const char* name)
+{
+    const std::size_t length = std::strlen(name);
+    return std::strncmp(entry, name, length) == 0 && entry[length] == '=';
+}
+
+void backoff(unsigned& idle)
+{
+    const auto delay = std::chrono::microseconds(20) * (1u << std::min(idle, 5u));
+    std::this_thread::sleep_for(delay);
+    idle += 1;
+}
+
+} // namespace
+
+namespace cheatengine {
+
+AgentClient::AgentClient(std::string agent_library)
+    : agent_library_(std::move(agent_library))
+{
+}
+
+AgentClient::~AgentClient()
+{
+    destroyChannel();
+}
+
+std::optional<pid_t> AgentClient::launch(const std::string& executable,
+    const std::vector<std::string>& arguments,
+    std::string& error)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    destroyChannel();
+    pid_ = 0;
+
+    if (!createChannel(error)) {
+        return std::nullopt;
+    }
+
+    std::vector<std::string> environment;
+    std::string inserted = agent_library_;
+    for (char** entry = environ; entry != nullptr && *entry != nullptr; ++entry) {
+        if (startsWith(*entry, insert_libraries_env)) {
+            inserted += ':';
+            inserted += *entry + std::strlen(insert_libraries_env) + 1;
+            continue;
+        }
+        if (startsWith(*entry, AgentChannel::channel_env)) {
+            continue;
+        }
+        environment.emplace_back(*entry);
+    }
+    environment.push_back(std::string(insert_libraries_env) + '=' + inserted);
+    environment.push_back(std::string(AgentChannel::channel_env) + '=' + channel_name_);
+
+    std::vector<char*> envp;
+    for (auto& entry : environment) {
+        envp.push_back(entry.data());
+    }
+    envp.push_back(nullptr);
+
+    std::vector<std::string> argument_storage = arguments;
+    if (argument_storage.empty()) {
+        argument_storage.push_back(executable);
+    }
+    std::vector<char*> argv;
+    for (auto& argument : argument_storage) {
+        argv.push_back(argument.data());
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid = 0;
+    const int rc = posix_spawn(&pid, executable.c_str(), nullptr, nullptr, argv.data(), envp.data());
+    if (rc != 0) {
+        error = "posix_spawn failed: " + std::string(std::strerror(rc));
+        destroyChannel();
+        return std::nullopt;
+    }
+
+    pid_ = pid;
+    return pid;
+}
+
+bool AgentClient::connected() const
+{
+    if (channel_ == nullptr || channel_->state.load(std::memory_order_acquire) != AgentChannel::READY) {
+        return false;
+    }
+    return kill(channel_->agent_pid, 0) == 0;
+}
+
+bool AgentClient::waitForAgent(std::chrono::milliseconds timeout) const
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!connected()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+bool AgentClient::searchInProcess(const SearchValue& value, MemoryScanner::ResultList& results)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto& needle = value.data();
+    if (needle.empty() || needle.size() > AgentChannel::max_needle || !connected()) {
+        return false;
+    }
+
+    // An abandoned query may still be unwinding on the agent side.
+    const std::uint64_t previous = channel_->request_seq.load(std::memory_order_relaxed);
+    if (channel_->complete_seq.load(std::memory_order_acquire) != previous) {
+        return false;
+    }
+
+    std::memcpy(channel_->needle, needle.data(), needle.size());
+    channel_->needle_size = static_cast<std::uint32_t>(needle.size());
+    channel_->cancel.store(0, std::memory_order_relaxed);
+    channel_->bytes_scanned.store(0, std::memory_order_relaxed);
+    std::uint64_t tail = channel_->head.load(std::memory_order_relaxed);
+    channel_->tail.store(tail, std::memory_order_relaxed);
+
+    const std::uint64_t seq = previous + 1;
+    channel_->request_seq.store(seq, std::memory_order_release);
+
+    const std::size_t original_size = results.size();
+    std::uint64_t last_heartbeat = channel_->heartbeat.load(std::memory_order_relaxed);
+    auto last_progress = std::chrono::steady_clock::now();
+    unsigned idle = 0;
+
+    while (true) {
+        // Sampled before head so every address pushed before completion is
+        // visible below.
+        const bool complete = channel_->complete_seq.load(std::memory_order_acquire) == seq;
+        const std::uint64_t head = channel_->head.load(std::memory_order_acquire);
+
+        if (head != tail) {
+            for (; tail != head; ++tail) {
+                // The agent matched these bytes exactly, so the needle is
+                // the hit's context; surrounding bytes never cross back.
+                results.push_back({channel_->ring[tail % AgentChannel::ring_capacity],
+                                   std::pmr::vector<std::uint8_t>(needle.begin(), needle.end(), results.get_allocator().resource()),
+                                   needle.size()});
+            }
+            channel_->tail.store(tail, std::memory_order_release);
+            last_progress = std::chrono::steady_clock::now();
+            idle = 0;
+            continue;
+        }
+
+        if (complete) {
+            return true;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        const std::uint64_t heartbeat = channel_->heartbeat.load(std::memory_order_relaxed);
+        if (heartbeat != last_heartbeat) {
+            last_heartbeat = heartbeat;
+            last_progress = now;
+        } else if (now - last_progress > stall_timeout) {
+            channel_->cancel.store(1, std::memory_order_relaxed);
+            results.erase(results.begin() + static_cast<std::ptrdiff_t>(original_size), results.end());
+            return false;
+        }
+        backoff(idle);
+    }
+}
+
+MemoryScanner::ResultList AgentClient::search(const MemoryScanner& remote, task_t task, const SearchValue& value)
+{
+    MemoryScanner::ResultList results;
+    if (searchInProcess(value, results)) {
+        return results;
+    }
+    return remote.search(task, value, std::pmr::get_default_resource());
+}
+
+bool AgentClient::createChannel(std::string& error)
+{
+    channel_name_ = "/ceagent." + std::to_string(getpid()) + '.' + std::to_string(channel_counter.fetch_add(1));
+
+    const int fd = shm_open(channel_name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        error = "shm_open failed: " + std::string(std::strerror(errno));
+        return false;
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(sizeof(AgentChannel))) != 0) {
+        error = "ftruncate failed: " + std::string(std::strerror(errno));
+        close(fd);
+        shm_unlink(channel_name_.c_str());
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, sizeof(AgentChannel), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        error = "mmap failed: " + std::string(std::strerror(errno));
+        shm_unlink(channel_name_.c_str());
+        return false;
+    }
+
+    channel_ = new (mapping) AgentChannel();
+    channel_->client_pid = getpid();
+    return true;
+}
+
+void AgentClient::destroyChannel()
+{
+    if (channel_ == nullptr) {
+        return;
+    }
+
+    channel_->cancel.store(1, std::memory_order_relaxed);
+    channel_->state.store(AgentChannel::STOPPED, std::memory_order_release);
+    channel_->~AgentChannel();
+    munmap(channel_, sizeof(AgentChannel));
+    shm_unlink(channel_name_.c_str());
+    channel_ = nullptr;
+    channel_name_.clear();
+}
+
+} // namespace cheatengine
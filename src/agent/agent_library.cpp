@@ -0,0 +1,320 @@
+// In-process scan agent. Built as libcheatengine_agent.dylib and injected
+// with DYLD_INSERT_LIBRARIES by AgentClient::launch(); it maps the channel
+// named in the environment and answers queries by matching the host's own
+// mappings in place, so no byte is copied and only match addresses cross back
+// to the controller.
+#include "cheatengine/agent/agent_channel.hpp"
+#include "cheatengine/memory/scan_kernel.hpp"
+
+#include <mach/mach.h>
+#include <mach/mach_vm.h>
+
+#include <pthread.h>
+
+#include <cerrno>
+#include <csetjmp>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace {
+
+using cheatengine::AgentChannel;
+
+// Bytes matched between heartbeats and region re-checks; consecutive chunks
+// overlap by needle_size - 1 so no match is split.
+constexpr std::size_t scan_chunk = 1024 * 1024;
+
+AgentChannel* channel = nullptr;
+std::atomic<bool> running{false};
+
+// Fault recovery for the scan thread. While it matches a chunk, a SIGSEGV or
+// SIGBUS inside [guard_begin, guard_end) on that thread jumps back to
+// matchChunk(); every other fault goes to the handler that was installed
+// before ours.
+pthread_t scan_thread;
+sigjmp_buf fault_recovery;
+volatile std::uintptr_t guard_begin = 0;
+volatile std::uintptr_t guard_end = 0;
+struct sigaction previous_segv;
+struct sigaction previous_bus;
+bool handlers_installed = false;
+
+void backoff(unsigned& idle)
+{
+    const auto delay = std::chrono::microseconds(50) * (1u << std::min(idle, 4u));
+    std::this_thread::sleep_for(delay);
+    idle += 1;
+}
+
+bool clientAlive()
+{
+    return kill(channel->client_pid, 0) == 0 || errno == EPERM;
+}
+
+bool shouldStop()
+{
+    return !running.load(std::memory_order_relaxed) || channel->cancel.load(std::memory_order_relaxed) != 0;
+}
+
+// Blocks while the ring is full; gives up when the query is cancelled or the
+// client went away.
+bool push(std::uint64_t address)
+{
+    const std::uint64_t head = channel->head.load(std::memory_order_relaxed);
+    unsigned idle = 0;
+    while (head - channel->tail.load(std::memory_order_acquire) >= AgentChannel::ring_capacity) {
+        if (shouldStop() || (idle > 8 && !clientAlive())) {
+            return false;
+        }
+        channel->heartbeat.fetch_add(1, std::memory_order_relaxed);
+        backoff(idle);
+    }
+
+    channel->ring[head % AgentChannel::ring_capacity] = address;
+    channel->head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+bool overlaps(mach_vm_address_t address, mach_vm_size_t size, const void* object, std::size_t object_size)
+{
+    const auto begin = reinterpret_cast<mach_vm_address_t>(object);
+    return address < begin + object_size && address + size > begin;
+}
+
+void onFault(int signal, siginfo_t* info, void* context)
+{
+    const auto address = reinterpret_cast<std::uintptr_t>(info->si_addr);
+    if (guard_end != 0 && pthread_equal(pthread_self(), scan_thread) && address >= guard_begin
+        && address < guard_end) {
+        guard_end = 0;
+        siglongjmp(fault_recovery, 1);
+    }
+
+    const struct sigaction& previous = signal == SIGBUS ? previous_bus : previous_segv;
+    if ((previous.sa_flags & SA_SIGINFO) != 0) {
+        previous.sa_sigaction(signal, info, context);
+        return;
+    }
+    if (previous.sa_handler == SIG_DFL || previous.sa_handler == SIG_IGN) {
+        // Returning re-executes the faulting instruction, which then takes
+        // the default action; an ignored fault would only loop.
+        struct sigaction fallback = previous;
+        fallback.sa_handler = SIG_DFL;
+        sigaction(signal, &fallback, nullptr);
+        return;
+    }
+    previous.sa_handler(signal);
+}
+
+void installFaultHandlers()
+{
+    struct sigaction action{};
+    action.sa_sigaction = onFault;
+    action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+
+    scan_thread = pthread_self();
+    handlers_installed = sigaction(SIGSEGV, &action, &previous_segv) == 0;
+    if (handlers_installed && sigaction(SIGBUS, &action, &previous_bus) != 0) {
+        sigaction(SIGSEGV, &previous_segv, nullptr);
+        handlers_installed = false;
+    }
+}
+
+// Puts `previous` back unless someone replaced our handler meanwhile.
+void restoreFaultHandler(int signal, const struct sigaction& previous)
+{
+    struct sigaction current{};
+    if (sigaction(signal, nullptr, &current) == 0 && (current.sa_flags & SA_SIGINFO) != 0
+        && current.sa_sigaction == onFault) {
+        sigaction(signal, &previous, nullptr);
+    }
+}
+
+// Whether `address` still lies in a readable mapping. The host keeps running
+// during a scan, so what mach_vm_region_recurse reported may have been
+// unmapped or protected since.
+bool stillReadable(mach_vm_address_t address)
+{
+    mach_vm_address_t probe = address;
+    mach_vm_size_t probe_size = 0;
+    vm_region_basic_info_data_64_t info{};
+    mach_msg_type_number_t info_count = VM_REGION_BASIC_INFO_COUNT_64;
+    mach_port_t object = MACH_PORT_NULL;
+
+    const kern_return_t kr = mach_vm_region(mach_task_self(),
+        &probe,
+        &probe_size,
+        VM_REGION_BASIC_INFO_64,
+        reinterpret_cast<vm_region_info_t>(&info),
+        &info_count,
+        &object);
+    return kr == KERN_SUCCESS && probe <= address && (info.protection & VM_PROT_READ) != 0;
+}
+
+// Matches [begin, begin + length) in place. Returns false when the chunk
+// faulted part way; hits pushed before the fault stand. Nothing local is
+// modified between sigsetjmp and the match, so no state needs to be volatile.
+bool matchChunk(const std::uint8_t* begin,
+    std::size_t length,
+    const std::uint8_t* needle,
+    std::size_t needle_size,
+    bool& keep_going)
+{
+    if (sigsetjmp(fault_recovery, 1) != 0) {
+        return false;
+    }
+
+    guard_begin = reinterpret_cast<std::uintptr_t>(begin);
+    guard_end = guard_begin + length;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    const auto chunk_address = reinterpret_cast<std::uint64_t>(begin);
+    cheatengine::forEachMatch(begin, begin + length, needle, needle_size, [&](std::size_t match) {
+        keep_going = push(chunk_address + match);
+        return keep_going;
+    });
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    guard_end = 0;
+    return true;
+}
+
+// Each chunk is re-checked with mach_vm_region just before it is matched,
+// and a mapping that disappears in the window after that check faults into
+// matchChunk()'s recovery point instead of killing the host. The channel
+// holds the needle and is never scanned, so it does not show up as a hit.
+void runQuery()
+{
+    const std::uint8_t* needle = channel->needle;
+    const std::size_t needle_size = channel->needle_size;
+    if (needle_size == 0 || needle_size > AgentChannel::max_needle) {
+        return;
+    }
+    const std::size_t overlap = needle_size - 1;
+
+    mach_vm_address_t address = MACH_VM_MIN_ADDRESS;
+    mach_vm_size_t size = 0;
+    natural_t depth = 0;
+    bool keep_going = true;
+
+    while (keep_going && !shouldStop()) {
+        vm_region_submap_info_data_64_t info{};
+        mach_msg_type_number_t info_count = VM_REGION_SUBMAP_INFO_COUNT_64;
+
+        const kern_return_t kr = mach_vm_region_recurse(mach_task_self(),
+            &address,
+            &size,
+            &depth,
+            reinterpret_cast<vm_region_recurse_info_t>(&info),
+            &info_count);
+        if (kr != KERN_SUCCESS) {
+            break;
+        }
+
+        if (info.is_submap) {
+            depth += 1;
+            continue;
+        }
+
+        if ((info.protection & VM_PROT_READ) != 0 && !overlaps(address, size, channel, sizeof(AgentChannel))) {
+            for (mach_vm_size_t offset = 0; offset < size && keep_going && !shouldStop(); offset += scan_chunk) {
+                const mach_vm_size_t length = std::min<mach_vm_size_t>(scan_chunk + overlap, size - offset);
+                const auto* chunk = reinterpret_cast<const std::uint8_t*>(address + offset);
+                if (stillReadable(address + offset)
+                    && matchChunk(chunk, static_cast<std::size_t>(length), needle, needle_size, keep_going)) {
+                    channel->bytes_scanned.fetch_add(std::min<mach_vm_size_t>(scan_chunk, size - offset),
+                        std::memory_order_relaxed);
+                }
+                channel->heartbeat.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        channel->heartbeat.fetch_add(1, std::memory_order_relaxed);
+        address += size;
+    }
+}
+
+void serve()
+{
+    installFaultHandlers();
+    std::uint64_t handled = channel->request_seq.load(std::memory_order_acquire);
+    unsigned idle = 0;
+
+    // The client marks the channel stopped when it lets go of it.
+    while (running.load(std::memory_order_relaxed)
+           && channel->state.load(std::memory_order_acquire) == AgentChannel::READY) {
+        channel->heartbeat.fetch_add(1, std::memory_order_relaxed);
+
+        const std::uint64_t seq = channel->request_seq.load(std::memory_order_acquire);
+        if (seq != handled) {
+            runQuery();
+            channel->complete_seq.store(seq, std::memory_order_release);
+            handled = seq;
+            idle = 0;
+            continue;
+        }
+
+        if (idle > 8 && !clientAlive()) {
+            break;
+        }
+        backoff(idle);
+    }
+
+    if (handlers_installed) {
+        restoreFaultHandler(SIGSEGV, previous_segv);
+        restoreFaultHandler(SIGBUS, previous_bus);
+    }
+    channel->state.store(AgentChannel::STOPPED, std::memory_order_release);
+}
+
+__attribute__((constructor)) void agentLoad()
+{
+    const char* name = std::getenv(AgentChannel::channel_env);
+    if (name == nullptr) {
+        return;
+    }
+
+    const int fd = shm_open(name, O_RDWR, 0);
+    // Children of the target must not try to attach to the same channel.
+    unsetenv(AgentChannel::channel_env);
+    if (fd < 0) {
+        return;
+    }
+
+    void* mapping = mmap(nullptr, sizeof(AgentChannel), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return;
+    }
+
+    auto* candidate = static_cast<AgentChannel*>(mapping);
+    if (candidate->magic != AgentChannel::magic_value || candidate->version != AgentChannel::version_value) {
+        munmap(mapping, sizeof(AgentChannel));
+        return;
+    }
+
+    channel = candidate;
+    channel->agent_pid = getpid();
+    running.store(true, std::memory_order_relaxed);
+    channel->state.store(AgentChannel::READY, std::memory_order_release);
+    std::thread(serve).detach();
+}
+
+__attribute__((destructor)) void agentUnload()
+{
+    if (channel == nullptr) {
+        return;
+    }
+    running.store(false, std::memory_order_relaxed);
+    channel->state.store(AgentChannel::STOPPED, std::memory_order_release);
+}
+
+} // namespace
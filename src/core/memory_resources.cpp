@@ -0,0 +1,110 @@
+#include "cheatengine/core/memory_resources.hpp"
+
+#include <mach/mach.h>
+#include <mach/mach_vm.h>
+
+#include <new>
+
+namespace {
+
+bool tryVmAllocate(mach_vm_size_t size, int flags, mach_vm_address_t& out)
+{
+    out = 0;
+    return mach_vm_allocate(mach_task_self(), &out, size, flags) == KERN_SUCCESS;
+}
+
+} // namespace
+
+namespace cheatengine {
+
+CountingResource::CountingResource(std::pmr::memory_resource* upstream) noexcept
+    : upstream_(upstream != nullptr ? upstream : std::pmr::get_default_resource())
+{
+}
+
+AllocationStats CountingResource::stats() const noexcept
+{
+    AllocationStats stats;
+    stats.allocations = allocations_.load(std::memory_order_relaxed);
+    stats.deallocations = deallocations_.load(std::memory_order_relaxed);
+    stats.bytes_allocated = bytes_allocated_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void CountingResource::resetStats() noexcept
+{
+    allocations_.store(0, std::memory_order_relaxed);
+    deallocations_.store(0, std::memory_order_relaxed);
+    bytes_allocated_.store(0, std::memory_order_relaxed);
+}
+
+void* CountingResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    void* p = upstream_->allocate(bytes, alignment);
+    allocations_.fetch_add(1, std::memory_order_relaxed);
+    bytes_allocated_.fetch_add(bytes, std::memory_order_relaxed);
+    return p;
+}
+
+void CountingResource::do_deallocate(void* p, std::size_t bytes, std::size_t alignment)
+{
+    upstream_->deallocate(p, bytes, alignment);
+    deallocations_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool CountingResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+HugePageResource::HugePageResource(std::size_t threshold, std::pmr::memory_resource* upstream) noexcept
+    : threshold_(threshold)
+    , upstream_(upstream != nullptr ? upstream : std::pmr::get_default_resource())
+{
+}
+
+void* HugePageResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    if (bytes < threshold_ || alignment > vm_page_size) {
+        return upstream_->allocate(bytes, alignment);
+    }
+
+    mach_vm_address_t address = 0;
+#ifdef VM_FLAGS_SUPERPAGE_SIZE_ANY
+    if (tryVmAllocate(bytes, VM_FLAGS_ANYWHERE | VM_FLAGS_SUPERPAGE_SIZE_ANY, address)) {
+        return reinterpret_cast<void*>(address);
+    }
+#endif
+    if (tryVmAllocate(bytes, VM_FLAGS_ANYWHERE, address)) {
+        return reinterpret_cast<void*>(address);
+    }
+    throw std::bad_alloc();
+}
+
+void HugePageResource::do_deallocate(void* p, std::size_t bytes, std::size_t alignment)
+{
+    if (bytes < threshold_ || alignment > vm_page_size) {
+        upstream_->deallocate(p, bytes, alignment);
+        return;
+    }
+    mach_vm_deallocate(mach_task_self(), reinterpret_cast<mach_vm_address_t>(p), bytes);
+}
+
+bool HugePageResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+std::pmr::memory_resource* threadBufferPool()
+{
+    thread_local std::pmr::unsynchronized_pool_resource pool;
+    return &pool;
+}
+
+std::pmr::memory_resource* hugePageResource()
+{
+    static HugePageResource resource;
+    return &resource;
+}
+
+} // namespace cheatengine
@@ -0,0 +1,110 @@
+#include "cheatengine/core/thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace cheatengine {
+
+ThreadPool::ThreadPool(std::size_t threads)
+{
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    workers_.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    cv_.notify_one();
+}
+
+void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t)>& fn)
+{
+    if (count == 0) {
+        return;
+    }
+
+    struct Group {
+        std::atomic<std::size_t> next{0};
+        std::size_t runners_left{0};
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+
+    auto group = std::make_shared<Group>();
+    const std::size_t runners = std::min(count, workers_.size());
+    group->runners_left = runners;
+
+    auto runner = [group, count, &fn]() {
+        std::exception_ptr error;
+        for (std::size_t i = group->next.fetch_add(1); i < count; i = group->next.fetch_add(1)) {
+            try {
+                fn(i);
+            } catch (...) {
+                error = std::current_exception();
+                group->next.store(count);
+                break;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(group->mutex);
+        if (error && !group->error) {
+            group->error = error;
+        }
+        if (--group->runners_left == 0) {
+            group->done.notify_all();
+        }
+    };
+
+    for (std::size_t i = 0; i < runners; ++i) {
+        submit(runner);
+    }
+
+    std::unique_lock<std::mutex> lock(group->mutex);
+    group->done.wait(lock, [&group]() { return group->runners_left == 0; });
+    if (group->error) {
+        std::rethrow_exception(group->error);
+    }
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+            if (stopping_ && tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
+
+} // namespace cheatengine
@@ -0,0 +1,1054 @@
+#include "cheatengine/daemon/daemon_server.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+using cheatengine::Request;
+using cheatengine::SearchValue;
+
+constexpr std::size_t read_size = 64 * 1024;
+constexpr std::size_t max_line_length = 1024 * 1024;
+constexpr std::size_t max_read_bytes = 1024 * 1024;
+// Past the soft limit a client's requests are left unread until it drains
+// its replies; past the hard limit (streamed batches it is not reading) it is
+// disconnected.
+constexpr std::size_t output_soft_limit = 4 * 1024 * 1024;
+constexpr std::size_t output_hard_limit = 64 * 1024 * 1024;
+constexpr std::int64_t default_page_limit = 1000;
+// How long "launch" waits for the injected agent before replying.
+constexpr std::chrono::milliseconds agent_ready_timeout{500};
+
+bool setNonBlocking(int fd)
+{
+    const int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// Clears the way for bind(): a leftover socket from a daemon that is gone
+// (connect is refused) is removed; a live daemon's socket, or anything that
+// is not a socket, is left alone.
+bool removeStaleSocket(const std::string& path, const sockaddr_un& address, std::string& error)
+{
+    struct stat info {};
+    if (lstat(path.c_str(), &info) != 0) {
+        if (errno == ENOENT) {
+            return true;
+        }
+        error = path + ": " + std::strerror(errno);
+        return false;
+    }
+    if (!S_ISSOCK(info.st_mode)) {
+        error = path + ": address in use";
+        return false;
+    }
+
+    const int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe < 0) {
+        error = std::string("socket: ") + std::strerror(errno);
+        return false;
+    }
+    const int connected = connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+    const int connect_error = errno;
+    close(probe);
+    if (connected == 0 || connect_error != ECONNREFUSED) {
+        error = path + ": address in use";
+        return false;
+    }
+
+    if (unlink(path.c_str()) != 0 && errno != ENOENT) {
+        error = path + ": " + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+int hexDigit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+std::optional<SearchValue> parseValue(const Request& request, std::string& error)
+{
+    const std::string type = request.string("type").value_or("int32");
+
+    if (type == "int32" || type == "int64") {
+        const auto value = request.integer("value");
+        if (!value) {
+            error = "'value' must be an integer";
+            return std::nullopt;
+        }
+        if (type == "int64") {
+            return SearchValue::fromInt64(*value);
+        }
+        if (*value < INT32_MIN || *value > INT32_MAX) {
+            error = "'value' out of range for int32";
+            return std::nullopt;
+        }
+        return SearchValue::fromInt32(static_cast<std::int32_t>(*value));
+    }
+
+    if (type == "float32" || type == "float64") {
+        const auto value = request.number("value");
+        if (!value) {
+            error = "'value' must be a number";
+            return std::nullopt;
+        }
+        return type == "float32" ? SearchValue::fromFloat32(static_cast<float>(*value))
+                                 : SearchValue::fromFloat64(*value);
+    }
+
+    if (type == "bytes") {
+        const auto hex = request.string("value");
+        if (!hex || hex->empty() || hex->size() % 2 != 0) {
+            error = "'value' must be an even-length hex string";
+            return std::nullopt;
+        }
+        std::vector<std::uint8_t> bytes(hex->size() / 2);
+        for (std::size_t i = 0; i < bytes.size(); ++i) {
+            const int high = hexDigit((*hex)[2 * i]);
+            const int low = hexDigit((*hex)[2 * i + 1]);
+            if (high < 0 || low < 0) {
+                error = "'value' must be an even-length hex string";
+                return std::nullopt;
+            }
+            bytes[i] = static_cast<std::uint8_t>((high << 4) | low);
+        }
+        return SearchValue::fromBytes(bytes);
+    }
+
+    error = "unknown type '" + type + "'";
+    return std::nullopt;
+}
+
+const char* statusName(cheatengine::ScanHandle::Status status)
+{
+    switch (status) {
+    case cheatengine::ScanHandle::Status::RUNNING:
+        return "running";
+    case cheatengine::ScanHandle::Status::COMPLETED:
+        return "completed";
+    case cheatengine::ScanHandle::Status::CANCELLED:
+        return "cancelled";
+    case cheatengine::ScanHandle::Status::DEADLINE_EXCEEDED:
+        return "deadline_exceeded";
+    case cheatengine::ScanHandle::Status::FAILED:
+        return "failed";
+    }
+    return "unknown";
+}
+
+void appendAddressArray(std::string& out, const cheatengine::MemoryScanner::ResultList& results, std::size_t begin, std::size_t end)
+{
+    out.push_back('[');
+    for (std::size_t i = begin; i < end; ++i) {
+        if (i != begin) {
+            out.push_back(',');
+        }
+        out.push_back('"');
+        cheatengine::appendHexAddress(out, results[i].address);
+        out.push_back('"');
+    }
+    out.push_back(']');
+}
+
+} // namespace
+
+namespace cheatengine {
+
+DaemonServer::Session::~Session()
+{
+    job_cancelled.store(true, std::memory_order_relaxed);
+    if (job.valid()) {
+        job.wait();
+    }
+}
+
+DaemonServer::DaemonServer(Application& app, std::string socket_path, std::string agent_library)
+    : app_(app)
+    , socket_path_(std::move(socket_path))
+    , agent_library_(std::move(agent_library))
+{
+}
+
+DaemonServer::~DaemonServer()
+{
+    sessions_.clear();
+    monitors_.clear();
+
+    for (auto& entry : clients_) {
+        close(entry.second.fd);
+    }
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        unlink(socket_path_.c_str());
+    }
+    if (wake_read_fd_ >= 0) {
+        close(wake_read_fd_);
+    }
+    if (wake_write_fd_ >= 0) {
+        close(wake_write_fd_);
+    }
+}
+
+bool DaemonServer::start(std::string& error)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path_.empty() || socket_path_.size() >= sizeof(address.sun_path)) {
+        error = "socket path is empty or too long";
+        return false;
+    }
+    std::memcpy(address.sun_path, socket_path_.c_str(), socket_path_.size() + 1);
+
+    if (!removeStaleSocket(socket_path_, address, error)) {
+        return false;
+    }
+
+    int pipe_fds[2] = {-1, -1};
+    if (pipe(pipe_fds) != 0) {
+        error = std::string("pipe: ") + std::strerror(errno);
+        return false;
+    }
+    wake_read_fd_ = pipe_fds[0];
+    wake_write_fd_ = pipe_fds[1];
+    setNonBlocking(wake_read_fd_);
+    setNonBlocking(wake_write_fd_);
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+        error = std::string("socket: ") + std::strerror(errno);
+        return false;
+    }
+
+    const mode_t previous_mask = umask(077);
+    const int bound = bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+    umask(previous_mask);
+    if (bound != 0 || listen(listen_fd_, SOMAXCONN) != 0 || !setNonBlocking(listen_fd_)) {
+        error = socket_path_ + ": " + std::strerror(errno);
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+
+    std::signal(SIGPIPE, SIG_IGN);
+    running_.store(true);
+    return true;
+}
+
+void DaemonServer::stop() noexcept
+{
+    running_.store(false);
+    wake();
+}
+
+void DaemonServer::wake() noexcept
+{
+    if (wake_write_fd_ >= 0) {
+        const char byte = 1;
+        [[maybe_unused]] const ssize_t written = write(wake_write_fd_, &byte, 1);
+    }
+}
+
+void DaemonServer::run()
+{
+    std::vector<pollfd> fds;
+    std::vector<std::uint64_t> fd_clients;
+
+    while (running_.load()) {
+        fds.clear();
+        fd_clients.clear();
+        fds.push_back({wake_read_fd_, POLLIN, 0});
+        fds.push_back({listen_fd_, POLLIN, 0});
+        for (const auto& entry : clients_) {
+            const Client& client = entry.second;
+            const bool want_input = !client.read_closed && client.output.size() < output_soft_limit;
+            const short events = static_cast<short>((want_input ? POLLIN : 0) | (client.output.empty() ? 0 : POLLOUT));
+            // A half-closed client with nothing to send is parked (poll
+            // ignores negative fds) until one of its scans posts more.
+            fds.push_back({events != 0 ? client.fd : -1, events, 0});
+            fd_clients.push_back(entry.first);
+        }
+
+        if (::poll(fds.data(), static_cast<nfds_t>(fds.size()), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if ((fds[0].revents & POLLIN) != 0) {
+            char drain[256];
+            while (read(wake_read_fd_, drain, sizeof(drain)) > 0) {
+            }
+            drainWorkerMessages();
+        }
+        if ((fds[1].revents & POLLIN) != 0) {
+            acceptClients();
+        }
+
+        for (std::size_t i = 0; i < fd_clients.size(); ++i) {
+            auto it = clients_.find(fd_clients[i]);
+            if (it == clients_.end()) {
+                continue;
+            }
+            Client& client = it->second;
+            const short revents = fds[i + 2].revents;
+            if ((revents & POLLERR) != 0) {
+                client.closing = true;
+            } else if (!client.read_closed && (revents & (POLLIN | POLLHUP)) != 0) {
+                readClient(client);
+            }
+            flushClient(client);
+        }
+
+        for (auto it = clients_.begin(); it != clients_.end();) {
+            const Client& client = it->second;
+            const bool finished = client.read_closed && client.jobs_running == 0 && client.output.empty();
+            if (client.closing || finished) {
+                const std::uint64_t client_id = it->first;
+                for (auto session = sessions_.begin(); session != sessions_.end();) {
+                    if (session->second->client_id == client_id) {
+                        session = sessions_.erase(session);
+                    } else {
+                        ++session;
+                    }
+                }
+                close(it->second.fd);
+                it = clients_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // Deliver whatever was queued before shutdown, best effort.
+    for (auto& entry : clients_) {
+        flushClient(entry.second);
+    }
+}
+
+void DaemonServer::acceptClients()
+{
+    while (true) {
+        const int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+        setNonBlocking(fd);
+#ifdef SO_NOSIGPIPE
+        const int enable = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &enable, sizeof(enable));
+#endif
+        Client client;
+        client.id = next_client_id_++;
+        client.fd = fd;
+        clients_.emplace(client.id, std::move(client));
+    }
+}
+
+void DaemonServer::readClient(Client& client)
+{
+    char chunk[read_size];
+    while (true) {
+        const ssize_t n = read(client.fd, chunk, sizeof(chunk));
+        if (n > 0) {
+            client.input.append(chunk, static_cast<std::size_t>(n));
+            continue;
+        }
+        if (n == 0) {
+            client.read_closed = true;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            client.closing = true;
+        }
+        break;
+    }
+
+    // Handle every complete line in arrival order; a pipelined burst is
+    // answered in one flush.
+    std::size_t consumed = 0;
+    while (true) {
+        const std::size_t newline = client.input.find('\n', consumed);
+        if (newline == std::string::npos) {
+            break;
+        }
+        handleLine(client, std::string_view(client.input).substr(consumed, newline - consumed));
+        consumed = newline + 1;
+    }
+    client.input.erase(0, consumed);
+
+    if (client.input.size() > max_line_length) {
+        client.closing = true;
+    }
+    if (client.read_closed) {
+        // An unterminated last line is never going to be completed.
+        client.input.clear();
+    }
+}
+
+void DaemonServer::flushClient(Client& client)
+{
+    while (!client.output.empty()) {
+        const ssize_t n = write(client.fd, client.output.data(), client.output.size());
+        if (n > 0) {
+            client.output.erase(0, static_cast<std::size_t>(n));
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            return;
+        }
+        client.closing = true;
+        client.output.clear();
+        return;
+    }
+}
+
+void DaemonServer::handleLine(Client& client, std::string_view line)
+{
+    if (line.empty() || line.find_first_not_of(" \t\r") == std::string_view::npos) {
+        return;
+    }
+
+    static const std::unordered_map<std::string, Handler> handlers = {
+        {"ping", &DaemonServer::cmdPing},
+        {"attach", &DaemonServer::cmdAttach},
+        {"detach", &DaemonServer::cmdDetach},
+        {"list", &DaemonServer::cmdList},
+        {"regions", &DaemonServer::cmdRegions},
+        {"launch", &DaemonServer::cmdLaunch},
+        {"search", &DaemonServer::cmdSearch},
+        {"cancel", &DaemonServer::cmdCancel},
+        {"refine", &DaemonServer::cmdRefine},
+        {"results", &DaemonServer::cmdResults},
+        {"drop", &DaemonServer::cmdDrop},
+        {"read", &DaemonServer::cmdRead},
+        {"watch", &DaemonServer::cmdWatch},
+        {"unwatch", &DaemonServer::cmdUnwatch},
+        {"poll", &DaemonServer::cmdPoll},
+        {"shutdown", &DaemonServer::cmdShutdown},
+    };
+
+    std::string error;
+    auto request = Request::parse(line, error);
+    if (!request) {
+        reply(client, JsonWriter("null").field("error", error).finish());
+        return;
+    }
+
+    const auto command = request->string("cmd");
+    if (!command) {
+        replyError(client, *request, "missing 'cmd'");
+        return;
+    }
+
+    auto handler = handlers.find(*command);
+    if (handler == handlers.end()) {
+        replyError(client, *request, "unknown command '" + *command + "'");
+        return;
+    }
+
+    try {
+        (this->*(handler->second))(client, *request);
+    } catch (const std::exception& e) {
+        replyError(client, *request, e.what());
+    }
+}
+
+void DaemonServer::reply(Client& client, std::string line)
+{
+    if (client.closing) {
+        return;
+    }
+    if (client.output.size() + line.size() > output_hard_limit) {
+        client.closing = true;
+        client.output.clear();
+        return;
+    }
+    if (client.output.empty()) {
+        client.output = std::move(line);
+    } else {
+        client.output += line;
+    }
+}
+
+void DaemonServer::replyError(Client& client, const Request& request, std::string_view message)
+{
+    reply(client, JsonWriter(request.idJson()).field("error", message).finish());
+}
+
+void DaemonServer::postFromWorker(WorkerMessage message)
+{
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex_);
+        worker_messages_.push_back(std::move(message));
+    }
+    wake();
+}
+
+void DaemonServer::drainWorkerMessages()
+{
+    std::vector<WorkerMessage> messages;
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex_);
+        messages.swap(worker_messages_);
+    }
+
+    for (auto& message : messages) {
+        auto client = clients_.find(message.client_id);
+        const bool job_done = message.scan_complete || message.refine_complete;
+        if (job_done && client != clients_.end() && client->second.jobs_running > 0) {
+            --client->second.jobs_running;
+        }
+
+        if (message.scan_complete) {
+            auto session = sessions_.find(message.session_id);
+            if (session == sessions_.end()) {
+                continue;
+            }
+            Session& s = *session->second;
+            std::size_t count = 0;
+            {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                count = s.results.size();
+            }
+            auto status = ScanHandle::Status::COMPLETED;
+            if (s.scan) {
+                status = s.scan->status();
+            } else if (s.job_cancelled.load(std::memory_order_relaxed)) {
+                status = ScanHandle::Status::CANCELLED;
+            }
+            message.line = JsonWriter(s.request_id)
+                               .field("session", s.id)
+                               .field("done", true)
+                               .field("status", statusName(status))
+                               .field("count", static_cast<std::uint64_t>(count))
+                               .finish();
+        }
+
+        if (client != clients_.end()) {
+            reply(client->second, std::move(message.line));
+        }
+    }
+}
+
+std::optional<ProcessManager::ProcessInfo> DaemonServer::requireProcess(Client& client, const Request& request)
+{
+    const auto pid = request.integer("pid");
+    if (!pid) {
+        replyError(client, request, "missing 'pid'");
+        return std::nullopt;
+    }
+    auto info = app_.processSet().find(static_cast<pid_t>(*pid));
+    if (!info) {
+        replyError(client, request, "process not attached");
+    }
+    return info;
+}
+
+DaemonServer::Session* DaemonServer::requireSession(Client& client, const Request& request)
+{
+    const auto id = request.integer("session");
+    if (!id) {
+        replyError(client, request, "missing 'session'");
+        return nullptr;
+    }
+    auto it = sessions_.find(static_cast<std::uint64_t>(*id));
+    if (it == sessions_.end()) {
+        replyError(client, request, "unknown session");
+        return nullptr;
+    }
+    return it->second.get();
+}
+
+const std::vector<MemoryRegion>& DaemonServer::regionsFor(const ProcessManager::ProcessInfo& info, bool refresh)
+{
+    auto& cached = region_cache_[info.pid];
+    const auto now = std::chrono::steady_clock::now();
+    if (refresh || cached.taken == std::chrono::steady_clock::time_point{} || now - cached.taken >= region_cache_ttl) {
+        cached.regions = app_.memoryScanner().enumerate(info.task_port);
+        cached.taken = now;
+    }
+    return cached.regions;
+}
+
+void DaemonServer::cmdPing(Client& client, const Request& request)
+{
+    reply(client, JsonWriter(request.idJson()).field("ok", true).finish());
+}
+
+void DaemonServer::cmdAttach(Client& client, const Request& request)
+{
+    if (const auto path = request.string("path")) {
+        const std::size_t attached = app_.processSet().attachByPath(*path);
+        reply(client, JsonWriter(request.idJson()).field("ok", true).field("attached", static_cast<std::uint64_t>(attached)).finish());
+        return;
+    }
+
+    const auto pid = request.integer("pid");
+    if (!pid) {
+        replyError(client, request, "missing 'pid' or 'path'");
+        return;
+    }
+    if (!app_.processSet().attach(static_cast<pid_t>(*pid))) {
+        replyError(client, request, "attach failed");
+        return;
+    }
+    reply(client, JsonWriter(request.idJson()).field("ok", true).finish());
+}
+
+void DaemonServer::cmdDetach(Client& client, const Request& request)
+{
+    const auto pid = request.integer("pid");
+    if (!pid) {
+        replyError(client, request, "missing 'pid'");
+        return;
+    }
+
+    const auto target = static_cast<pid_t>(*pid);
+    for (auto it = sessions_.begin(); it != sessions_.end();) {
+        if (it->second->pid == target) {
+            it = sessions_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    monitors_.erase(target);
+    region_cache_.erase(target);
+    agents_.erase(target);
+    app_.processSet().detach(target);
+    reply(client, JsonWriter(request.idJson()).field("ok", true).finish());
+}
+
+void DaemonServer::cmdList(Client& client, const Request& request)
+{
+    std::string list = "[";
+    bool first = true;
+    for (const auto& info : app_.processSet().processes()) {
+        if (!first) {
+            list.push_back(',');
+        }
+        first = false;
+        list += "{\"pid\":" + std::to_string(info.pid) + ",\"path\":";
+        appendJsonString(list, info.executable_path);
+        list.push_back('}');
+    }
+    list.push_back(']');
+    reply(client, JsonWriter(request.idJson()).rawField("processes", list).finish());
+}
+
+void DaemonServer::cmdRegions(Client& client, const Request& request)
+{
+    const auto info = requireProcess(client, request);
+    if (!info) {
+        return;
+    }
+
+    const auto& regions = regionsFor(*info, request.flag("refresh"));
+
+    std::string list = "[";
+    for (std::size_t i = 0; i < regions.size(); ++i) {
+        const auto& region = regions[i];
+        if (i != 0) {
+            list.push_back(',');
+        }
+        list += "{\"start\":\"";
+        appendHexAddress(list, region.start_address);
+        list += "\",\"size\":" + std::to_string(region.size) + ",\"prot\":\"" + region.flags().toString() + "\",\"category\":";
+        appendJsonString(list, region.category);
+        list.push_back('}');
+    }
+    list.push_back(']');
+    reply(client, JsonWriter(request.idJson()).rawField("regions", list).finish());
+}
+
+void DaemonServer::cmdLaunch(Client& client, const Request& request)
+{
+    const auto path = request.string("path");
+    if (!path) {
+        replyError(client, request, "missing 'path'");
+        return;
+    }
+    if (agent_library_.empty()) {
+        replyError(client, request, "no agent library configured");
+        return;
+    }
+
+    auto agent = std::make_unique<AgentClient>(agent_library_);
+    std::string error;
+    const auto pid = agent->launch(*path, {}, error);
+    if (!pid) {
+        replyError(client, request, error);
+        return;
+    }
+    if (!app_.processSet().attach(*pid)) {
+        kill(*pid, SIGKILL);
+        replyError(client, request, "attach failed");
+        return;
+    }
+
+    // The agent reports ready from its load-time constructor; searches check
+    // again, so a slow start only costs the first one its in-process path.
+    const bool in_process = agent->waitForAgent(agent_ready_timeout);
+    agents_[*pid] = std::move(agent);
+    region_cache_.erase(*pid);
+    reply(client, JsonWriter(request.idJson()).field("pid", static_cast<std::int64_t>(*pid)).field("agent", in_process).finish());
+}
+
+void DaemonServer::cmdSearch(Client& client, const Request& request)
+{
+    const auto info = requireProcess(client, request);
+    if (!info) {
+        return;
+    }
+
+    std::string error;
+    const auto value = parseValue(request, error);
+    if (!value) {
+        replyError(client, request, error);
+        return;
+    }
+
+    auto session = std::make_unique<Session>();
+    session->id = next_session_id_++;
+    session->pid = info->pid;
+    session->value_size = value->data().size();
+    session->client_id = client.id;
+    session->request_id = request.idJson();
+
+    Session* raw = session.get();
+    const std::uint64_t client_id = client.id;
+
+    MemoryScanner::ScanOptions options;
+    options.on_batch = [this, raw, client_id](const MemoryScanner::ResultBatch& batch) {
+        std::string addresses;
+        appendAddressArray(addresses, batch, 0, batch.size());
+        {
+            std::lock_guard<std::mutex> lock(raw->mutex);
+            raw->results.insert(raw->results.end(), batch.begin(), batch.end());
+        }
+        postFromWorker({client_id,
+                        raw->id,
+                        JsonWriter(raw->request_id).field("session", raw->id).rawField("batch", addresses).finish(),
+                        false});
+    };
+    options.on_complete = [this, raw, client_id]() {
+        postFromWorker({client_id, raw->id, {}, true});
+    };
+    if (const auto deadline_ms = request.integer("deadline_ms")) {
+        options.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(*deadline_ms);
+    }
+    options.regions = regionsFor(*info, request.flag("refresh"));
+
+    sessions_.emplace(raw->id, std::move(session));
+    const auto agent = agents_.find(info->pid);
+    if (agent != agents_.end() && agent->second->connected()) {
+        searchInAgent(*raw, *agent->second, info->task_port, *value);
+    } else {
+        raw->scan.emplace(app_.memoryScanner().searchAsync(info->task_port, *value, std::move(options)));
+    }
+    ++client.jobs_running;
+
+    reply(client, JsonWriter(request.idJson()).field("session", raw->id).field("started", true).finish());
+}
+
+// Runs the search inside the target through its agent; AgentClient::search
+// falls back to a remote scan if the agent stops answering mid-query.
+void DaemonServer::searchInAgent(Session& session, AgentClient& agent, task_t task, const SearchValue& value)
+{
+    auto finished = std::make_shared<std::promise<void>>();
+    session.job = finished->get_future();
+
+    app_.threadPool().submit([this, &session, &agent, finished, task, value, &scanner = app_.memoryScanner()]() {
+        // Nothing may escape a pool task, and the promise must be fulfilled.
+        std::string line;
+        try {
+            if (!session.job_cancelled.load(std::memory_order_relaxed)) {
+                auto results = agent.search(scanner, task, value);
+                std::string addresses;
+                appendAddressArray(addresses, results, 0, results.size());
+                line = JsonWriter(session.request_id).field("session", session.id).rawField("batch", addresses).finish();
+                std::lock_guard<std::mutex> lock(session.mutex);
+                session.results.assign(results.begin(), results.end());
+            }
+        } catch (const std::exception& e) {
+            line = JsonWriter(session.request_id).field("error", e.what()).finish();
+        }
+
+        if (!line.empty()) {
+            postFromWorker({session.client_id, session.id, std::move(line), false});
+        }
+        postFromWorker({session.client_id, session.id, {}, true});
+        finished->set_value();
+    });
+}
+
+void DaemonServer::cmdCancel(Client& client, const Request& request)
+{
+    Session* session = requireSession(client, request);
+    if (session == nullptr) {
+        return;
+    }
+    if (session->scan) {
+        session->scan->cancel();
+    }
+    session->job_cancelled.store(true, std::memory_order_relaxed);
+    reply(client, JsonWriter(request.idJson()).field("ok", true).finish());
+}
+
+void DaemonServer::cmdRefine(Client& client, const Request& request)
+{
+    Session* session = requireSession(client, request);
+    if (session == nullptr) {
+        return;
+    }
+    if (session->scan && session->scan->status() == ScanHandle::Status::RUNNING) {
+        replyError(client, request, "scan still running");
+        return;
+    }
+    if (session->job.valid() && session->job.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        replyError(client, request, "search or refine still running");
+        return;
+    }
+
+    const auto info = app_.processSet().find(session->pid);
+    if (!info) {
+        replyError(client, request, "process not attached");
+        return;
+    }
+
+    std::string error;
+    const auto value = parseValue(request, error);
+    if (!value) {
+        replyError(client, request, error);
+        return;
+    }
+
+    // One read per candidate is too slow for the event loop on a large
+    // session, so the survivors are sifted on the pool. The session outlives
+    // the task (~Session waits), and detach drops the session before the
+    // task port goes away.
+    auto finished = std::make_shared<std::promise<void>>();
+    session->job = finished->get_future();
+    session->job_cancelled.store(false, std::memory_order_relaxed);
+    ++client.jobs_running;
+
+    app_.threadPool().submit([this,
+                                 session,
+                                 finished,
+                                 client_id = client.id,
+                                 request_id = request.idJson(),
+                                 task = info->task_port,
+                                 needle = value->data(),
+                                 &scanner = app_.memoryScanner()]() {
+        // Nothing may escape a pool task, and the promise must be fulfilled.
+        std::string line;
+        try {
+            MemoryScanner::ResultList candidates;
+            {
+                std::lock_guard<std::mutex> lock(session->mutex);
+                candidates = session->results;
+            }
+
+            MemoryScanner::ResultList survivors(candidates.get_allocator());
+            std::vector<std::uint8_t> buffer;
+            bool cancelled = false;
+            for (auto& candidate : candidates) {
+                if (session->job_cancelled.load(std::memory_order_relaxed)) {
+                    cancelled = true;
+                    break;
+                }
+                if (scanner.readChunk(task, candidate.address, needle.size(), buffer) && buffer == needle) {
+                    survivors.push_back(std::move(candidate));
+                }
+            }
+
+            if (cancelled) {
+                line = JsonWriter(request_id).field("error", "refine cancelled").finish();
+            } else {
+                std::lock_guard<std::mutex> lock(session->mutex);
+                session->results = std::move(survivors);
+                session->value_size = needle.size();
+                line = JsonWriter(request_id)
+                           .field("session", session->id)
+                           .field("count", static_cast<std::uint64_t>(session->results.size()))
+                           .finish();
+            }
+        } catch (const std::exception& e) {
+            line = JsonWriter(request_id).field("error", e.what()).finish();
+        }
+
+        WorkerMessage message;
+        message.client_id = client_id;
+        message.session_id = session->id;
+        message.line = std::move(line);
+        message.refine_complete = true;
+        postFromWorker(std::move(message));
+        finished->set_value();
+    });
+}
+
+void DaemonServer::cmdResults(Client& client, const Request& request)
+{
+    Session* session = requireSession(client, request);
+    if (session == nullptr) {
+        return;
+    }
+
+    const auto offset = static_cast<std::size_t>(std::max<std::int64_t>(0, request.integer("offset").value_or(0)));
+    const auto limit = static_cast<std::size_t>(std::max<std::int64_t>(0, request.integer("limit").value_or(default_page_limit)));
+
+    std::string addresses;
+    std::size_t total = 0;
+    {
+        std::lock_guard<std::mutex> lock(session->mutex);
+        total = session->results.size();
+        const std::size_t begin = std::min(offset, total);
+        const std::size_t end = std::min(begin + limit, total);
+        appendAddressArray(addresses, session->results, begin, end);
+    }
+
+    reply(client, JsonWriter(request.idJson())
+                      .field("session", session->id)
+                      .field("count", static_cast<std::uint64_t>(total))
+                      .rawField("addresses", addresses)
+                      .finish());
+}
+
+void DaemonServer::cmdDrop(Client& client, const Request& request)
+{
+    Session* session = requireSession(client, request);
+    if (session == nullptr) {
+        return;
+    }
+    const std::uint64_t id = session->id;
+    sessions_.erase(id);
+    reply(client, JsonWriter(request.idJson()).field("ok", true).finish());
+}
+
+void DaemonServer::cmdRead(Client& client, const Request& request)
+{
+    const auto info = requireProcess(client, request);
+    if (!info) {
+        return;
+    }
+    const auto address = request.address("address");
+    const auto size = request.integer("size");
+    if (!address || !size || *size <= 0 || static_cast<std::size_t>(*size) > max_read_bytes) {
+        replyError(client, request, "invalid 'address' or 'size'");
+        return;
+    }
+
+    if (!app_.memoryScanner().readChunk(info->task_port, *address, static_cast<std::size_t>(*size), read_buffer_)) {
+        replyError(client, request, "read failed");
+        return;
+    }
+
+    std::string data = "\"";
+    appendHexBytes(data, read_buffer_.data(), read_buffer_.size());
+    data.push_back('"');
+    reply(client, JsonWriter(request.idJson()).hexField("address", *address).rawField("data", data).finish());
+}
+
+void DaemonServer::cmdWatch(Client& client, const Request& request)
+{
+    const auto info = requireProcess(client, request);
+    if (!info) {
+        return;
+    }
+    const auto address = request.address("address");
+    const auto size = request.integer("size");
+    if (!address || !size || *size <= 0) {
+        replyError(client, request, "invalid 'address' or 'size'");
+        return;
+    }
+
+    auto& monitor = monitors_[info->pid];
+    if (!monitor) {
+        monitor = std::make_unique<ValueMonitor>();
+    }
+    monitor->addAddress(*address, static_cast<std::size_t>(*size));
+    reply(client, JsonWriter(request.idJson()).field("ok", true).finish());
+}
+
+void DaemonServer::cmdUnwatch(Client& client, const Request& request)
+{
+    const auto pid = request.integer("pid");
+    const auto address = request.address("address");
+    if (!pid || !address) {
+        replyError(client, request, "missing 'pid' or 'address'");
+        return;
+    }
+
+    auto it = monitors_.find(static_cast<pid_t>(*pid));
+    if (it != monitors_.end()) {
+        it->second->removeAddress(*address);
+    }
+    reply(client, JsonWriter(request.idJson()).field("ok", true).finish());
+}
+
+void DaemonServer::cmdPoll(Client& client, const Request& request)
+{
+    const auto info = requireProcess(client, request);
+    if (!info) {
+        return;
+    }
+
+    auto it = monitors_.find(info->pid);
+    if (it == monitors_.end()) {
+        reply(client, JsonWriter(request.idJson()).rawField("changes", "[]").finish());
+        return;
+    }
+
+    it->second->poll(info->task_port, changes_);
+
+    std::string list = "[";
+    for (std::size_t i = 0; i < changes_.size(); ++i) {
+        const auto& change = changes_[i];
+        if (i != 0) {
+            list.push_back(',');
+        }
+        list += "{\"address\":\"";
+        appendHexAddress(list, change.address);
+        list += "\",\"old\":\"";
+        appendHexBytes(list, change.old_value.data(), change.old_value.size());
+        list += "\",\"new\":\"";
+        appendHexBytes(list, change.new_value.data(), change.new_value.size());
+        list.push_back('"');
+        if (change.instruction_pointer != 0) {
+            list += ",\"ip\":\"";
+            appendHexAddress(list, change.instruction_pointer);
+            list += "\",\"thread\":" + std::to_string(change.thread_id);
+        }
+        list.push_back('}');
+    }
+    list.push_back(']');
+    reply(client, JsonWriter(request.idJson()).rawField("changes", list).finish());
+}
+
+void DaemonServer::cmdShutdown(Client& client, const Request& request)
+{
+    reply(client, JsonWriter(request.idJson()).field("ok", true).finish());
+    running_.store(false);
+}
+
+} // namespace cheatengine
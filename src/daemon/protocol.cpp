@@ -0,0 +1,450 @@
+#include "cheatengine/daemon/protocol.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+class Parser {
+public:
+    explicit Parser(std::string_view text)
+        : text_(text)
+    {
+    }
+
+    void skipSpace()
+    {
+        while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\r')) {
+            ++pos_;
+        }
+    }
+
+    bool consume(char expected)
+    {
+        skipSpace();
+        if (pos_ < text_.size() && text_[pos_] == expected) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    bool atEnd()
+    {
+        skipSpace();
+        return pos_ >= text_.size();
+    }
+
+    bool parseString(std::string& out)
+    {
+        if (!consume('"')) {
+            return false;
+        }
+        out.clear();
+        while (pos_ < text_.size()) {
+            const char c = text_[pos_++];
+            if (c == '"') {
+                return true;
+            }
+            if (c != '\\') {
+                out.push_back(c);
+                continue;
+            }
+            if (pos_ >= text_.size()) {
+                return false;
+            }
+            const char escaped = text_[pos_++];
+            switch (escaped) {
+            case '"':
+            case '\\':
+            case '/':
+                out.push_back(escaped);
+                break;
+            case 'n':
+                out.push_back('\n');
+                break;
+            case 't':
+                out.push_back('\t');
+                break;
+            case 'r':
+                out.push_back('\r');
+                break;
+            case 'u':
+                // Requests are ASCII; anything else is rejected rather than
+                // half-decoded.
+                if (pos_ + 4 > text_.size() || text_.compare(pos_, 2, "00") != 0) {
+                    return false;
+                }
+                {
+                    const int high = hexValue(text_[pos_ + 2]);
+                    const int low = hexValue(text_[pos_ + 3]);
+                    if (high < 0 || low < 0) {
+                        return false;
+                    }
+                    out.push_back(static_cast<char>(high * 16 + low));
+                }
+                pos_ += 4;
+                break;
+            default:
+                return false;
+            }
+        }
+        return false;
+    }
+
+    // Returns the raw token for numbers and literals.
+    bool parseToken(std::string& out)
+    {
+        skipSpace();
+        const std::size_t start = pos_;
+        while (pos_ < text_.size()) {
+            const char c = text_[pos_];
+            if (c == ',' || c == '}' || c == ' ' || c == '\t' || c == '\r') {
+                break;
+            }
+            ++pos_;
+        }
+        out.assign(text_.substr(start, pos_ - start));
+        return !out.empty();
+    }
+
+    char peek()
+    {
+        skipSpace();
+        return pos_ < text_.size() ? text_[pos_] : '\0';
+    }
+
+private:
+    std::string_view text_;
+    std::size_t pos_{0};
+};
+
+// The JSON number grammar: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?.
+// strtod alone would also take "nan", "inf", hex floats and leading '+'.
+bool isNumber(const std::string& token)
+{
+    std::size_t pos = 0;
+    const auto digits = [&token, &pos]() {
+        const std::size_t start = pos;
+        while (pos < token.size() && isDigit(token[pos])) {
+            ++pos;
+        }
+        return pos > start;
+    };
+
+    if (pos < token.size() && token[pos] == '-') {
+        ++pos;
+    }
+    if (pos < token.size() && token[pos] == '0') {
+        ++pos;
+    } else if (pos >= token.size() || !isDigit(token[pos]) || !digits()) {
+        return false;
+    }
+    if (pos < token.size() && token[pos] == '.') {
+        ++pos;
+        if (!digits()) {
+            return false;
+        }
+    }
+    if (pos < token.size() && (token[pos] == 'e' || token[pos] == 'E')) {
+        ++pos;
+        if (pos < token.size() && (token[pos] == '+' || token[pos] == '-')) {
+            ++pos;
+        }
+        if (!digits()) {
+            return false;
+        }
+    }
+    if (pos != token.size()) {
+        return false;
+    }
+
+    // Out of range for a double.
+    errno = 0;
+    std::strtod(token.c_str(), nullptr);
+    return errno == 0;
+}
+
+} // namespace
+
+namespace cheatengine {
+
+std::optional<Request> Request::parse(std::string_view line, std::string& error)
+{
+    Parser parser(line);
+    Request request;
+
+    if (!parser.consume('{')) {
+        error = "expected a JSON object";
+        return std::nullopt;
+    }
+
+    if (!parser.consume('}')) {
+        do {
+            std::string key;
+            if (!parser.parseString(key)) {
+                error = "expected a string key";
+                return std::nullopt;
+            }
+            if (!parser.consume(':')) {
+                error = "expected ':' after key";
+                return std::nullopt;
+            }
+
+            Field field;
+            if (parser.peek() == '"') {
+                field.kind = Kind::STRING;
+                if (!parser.parseString(field.text)) {
+                    error = "unterminated string";
+                    return std::nullopt;
+                }
+            } else {
+                if (!parser.parseToken(field.text)) {
+                    error = "expected a value";
+                    return std::nullopt;
+                }
+                if (field.text == "true" || field.text == "false") {
+                    field.kind = Kind::BOOLEAN;
+                } else if (field.text == "null") {
+                    field.kind = Kind::NULL_VALUE;
+                } else if (isNumber(field.text)) {
+                    field.kind = Kind::NUMBER;
+                } else {
+                    error = "unsupported value for '" + key + "'";
+                    return std::nullopt;
+                }
+            }
+
+            if (key == "id") {
+                if (field.kind == Kind::STRING) {
+                    request.id_json_.clear();
+                    appendJsonString(request.id_json_, field.text);
+                } else {
+                    request.id_json_ = field.text;
+                }
+            }
+            request.fields_[key] = std::move(field);
+        } while (parser.consume(','));
+
+        if (!parser.consume('}')) {
+            error = "expected '}'";
+            return std::nullopt;
+        }
+    }
+
+    if (!parser.atEnd()) {
+        error = "trailing characters after object";
+        return std::nullopt;
+    }
+    return request;
+}
+
+std::optional<std::string> Request::string(const std::string& key) const
+{
+    auto it = fields_.find(key);
+    if (it == fields_.end() || it->second.kind != Kind::STRING) {
+        return std::nullopt;
+    }
+    return it->second.text;
+}
+
+std::optional<std::int64_t> Request::integer(const std::string& key) const
+{
+    auto it = fields_.find(key);
+    if (it == fields_.end() || it->second.kind != Kind::NUMBER) {
+        return std::nullopt;
+    }
+    char* end = nullptr;
+    errno = 0;
+    const long long value = std::strtoll(it->second.text.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0') {
+        return std::nullopt;
+    }
+    return static_cast<std::int64_t>(value);
+}
+
+std::optional<std::uint64_t> Request::address(const std::string& key) const
+{
+    auto it = fields_.find(key);
+    if (it == fields_.end()) {
+        return std::nullopt;
+    }
+    if (it->second.kind != Kind::NUMBER && it->second.kind != Kind::STRING) {
+        return std::nullopt;
+    }
+
+    const std::string& text = it->second.text;
+    if (text.empty() || text[0] == '-') {
+        return std::nullopt;
+    }
+    char* end = nullptr;
+    errno = 0;
+    const unsigned long long value = std::strtoull(text.c_str(), &end, 0);
+    if (errno != 0 || *end != '\0') {
+        return std::nullopt;
+    }
+    return static_cast<std::uint64_t>(value);
+}
+
+std::optional<double> Request::number(const std::string& key) const
+{
+    auto it = fields_.find(key);
+    if (it == fields_.end() || it->second.kind != Kind::NUMBER) {
+        return std::nullopt;
+    }
+    return std::strtod(it->second.text.c_str(), nullptr);
+}
+
+bool Request::flag(const std::string& key) const
+{
+    auto it = fields_.find(key);
+    return it != fields_.end() && it->second.kind == Kind::BOOLEAN && it->second.text == "true";
+}
+
+JsonWriter::JsonWriter(const std::string& id_json)
+{
+    out_.reserve(64);
+    out_ += "{\"id\":";
+    out_ += id_json;
+}
+
+void JsonWriter::key(std::string_view name)
+{
+    out_.push_back(',');
+    appendJsonString(out_, name);
+    out_.push_back(':');
+}
+
+JsonWriter& JsonWriter::field(std::string_view name, std::string_view value)
+{
+    key(name);
+    appendJsonString(out_, value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::field(std::string_view name, std::int64_t value)
+{
+    key(name);
+    out_ += std::to_string(value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::field(std::string_view name, std::uint64_t value)
+{
+    key(name);
+    out_ += std::to_string(value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::field(std::string_view name, double value)
+{
+    key(name);
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+    out_ += buffer;
+    return *this;
+}
+
+JsonWriter& JsonWriter::field(std::string_view name, bool value)
+{
+    key(name);
+    out_ += value ? "true" : "false";
+    return *this;
+}
+
+JsonWriter& JsonWriter::hexField(std::string_view name, std::uint64_t value)
+{
+    key(name);
+    out_.push_back('"');
+    appendHexAddress(out_, value);
+    out_.push_back('"');
+    return *this;
+}
+
+JsonWriter& JsonWriter::rawField(std::string_view name, std::string_view json)
+{
+    key(name);
+    out_ += json;
+    return *this;
+}
+
+std::string JsonWriter::finish()
+{
+    out_ += "}\n";
+    return std::move(out_);
+}
+
+void appendJsonString(std::string& out, std::string_view value)
+{
+    static constexpr char digits[] = "0123456789abcdef";
+
+    out.push_back('"');
+    for (const char c : value) {
+        switch (c) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                out += "\\u00";
+                out.push_back(digits[(static_cast<unsigned char>(c) >> 4) & 0xF]);
+                out.push_back(digits[static_cast<unsigned char>(c) & 0xF]);
+            } else {
+                out.push_back(c);
+            }
+            break;
+        }
+    }
+    out.push_back('"');
+}
+
+void appendHexAddress(std::string& out, std::uint64_t value)
+{
+    char buffer[24];
+    std::snprintf(buffer, sizeof(buffer), "0x%llx", static_cast<unsigned long long>(value));
+    out += buffer;
+}
+
+void appendHexBytes(std::string& out, const std::uint8_t* data, std::size_t size)
+{
+    static constexpr char digits[] = "0123456789abcdef";
+
+    for (std::size_t i = 0; i < size; ++i) {
+        out.push_back(digits[data[i] >> 4]);
+        out.push_back(digits[data[i] & 0xF]);
+    }
+}
+
+} // namespace cheatengine
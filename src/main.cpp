@@ -1,12 +1,68 @@
 #include "cheatengine/core/application.hpp"
+#include "cheatengine/daemon/daemon_server.hpp"
 
+#include <csignal>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
+#include <string>
 
-int main()
+namespace {
+
+constexpr const char* default_socket_path = "/tmp/cheatengine.sock";
+constexpr const char* agent_library_name = "libcheatengine_agent.dylib";
+
+cheatengine::DaemonServer* active_daemon = nullptr;
+
+void handleTerminate(int)
+{
+    if (active_daemon != nullptr) {
+        active_daemon->stop();
+    }
+}
+
+// The build puts the agent library next to the executable.
+std::string agentLibraryPath(const char* argv0)
+{
+    const std::string executable(argv0);
+    const auto slash = executable.rfind('/');
+    if (slash == std::string::npos) {
+        return agent_library_name;
+    }
+    return executable.substr(0, slash + 1) + agent_library_name;
+}
+
+int runDaemon(cheatengine::Application& app, const std::string& socket_path, const std::string& agent_library)
+{
+    cheatengine::DaemonServer server(app, socket_path, agent_library);
+
+    std::string error;
+    if (!server.start(error)) {
+        std::cerr << "cheatengine: failed to start daemon: " << error << std::endl;
+        return 1;
+    }
+
+    active_daemon = &server;
+    std::signal(SIGINT, handleTerminate);
+    std::signal(SIGTERM, handleTerminate);
+
+    std::cout << "CheatEngine daemon listening on " << socket_path << std::endl;
+    server.run();
+
+    active_daemon = nullptr;
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
 {
     cheatengine::Application app;
-    (void)app;
+
+    if (argc > 1 && std::strcmp(argv[1], "--daemon") == 0) {
+        return runDaemon(app, argc > 2 ? argv[2] : default_socket_path, agentLibraryPath(argv[0]));
+    }
+
     std::cout << "CheatEngine prototype initialized." << std::endl;
 
     std::cout << "Testing program..." << std::endl;
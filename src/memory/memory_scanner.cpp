@@ -1,4 +1,6 @@
 #include "cheatengine/memory/memory_scanner.hpp"
+#include "cheatengine/memory/scan_handle.hpp"
+#include "cheatengine/memory/scan_kernel.hpp"
 #include "cheatengine/core/errors.hpp"
 
 #include <algorithm>
@@ -6,8 +8,107 @@
 
 #include <mach/mach_vm.h>
 
+namespace {
+
+// Reads into `buffer`, reusing its capacity so steady-state scans do not
+// allocate.
+template <typename Buffer>
+bool readInto(task_t task, mach_vm_address_t address, std::size_t size, Buffer& buffer)
+{
+    if (task == MACH_PORT_NULL || size == 0) {
+        buffer.clear();
+        return false;
+    }
+
+    buffer.resize(size);
+
+    mach_vm_size_t out_size = 0;
+
+    kern_return_t kr = mach_vm_read_overwrite(
+        task,
+        address,
+        static_cast<mach_vm_size_t>(size),
+        reinterpret_cast<mach_vm_address_t>(buffer.data()),
+        &out_size);
+
+    if (kr != KERN_SUCCESS || out_size == 0) {
+        buffer.clear();
+        return false;
+    }
+
+    if (out_size < size) {
+        buffer.resize(static_cast<std::size_t>(out_size));
+    }
+
+    return true;
+}
+
+// Matches never cross a span edge: the bytes on the far side were not read.
+void appendMatches(const std::pmr::vector<std::uint8_t>& bytes,
+    const cheatengine::ReadEngine::Span& span,
+    const std::vector<std::uint8_t>& needle,
+    mach_vm_address_t base_address,
+    std::size_t context_bytes,
+    cheatengine::MemoryScanner::ResultList& results,
+    cheatengine::AllocationStats* result_allocations)
+{
+    using difference_type = std::pmr::vector<std::uint8_t>::difference_type;
+    const std::uint8_t* span_begin = bytes.data() + span.offset;
+
+    cheatengine::forEachMatch(span_begin, span_begin + span.size, needle.data(), needle.size(), [&](std::size_t offset) {
+        const std::size_t match_index = span.offset + offset;
+
+        const std::size_t context_start =
+            (match_index > span.offset + context_bytes)
+                ? match_index - context_bytes
+                : span.offset;
+
+        const std::size_t context_end =
+            std::min(match_index + needle.size() + context_bytes,
+                     span.offset + span.size);
+
+        cheatengine::MemoryScanner::SearchResult result;
+        result.address = base_address + match_index;
+        result.context = std::pmr::vector<std::uint8_t>(
+            bytes.begin() + static_cast<difference_type>(context_start),
+            bytes.begin() + static_cast<difference_type>(context_end),
+            results.get_allocator());
+        result.value_size = needle.size();
+
+        // Every request to the result resource happens here, so counting is
+        // exact without wrapping the caller's arena.
+        const std::size_t capacity = results.capacity();
+        if (result_allocations != nullptr && !result.context.empty()) {
+            result_allocations->allocations += 1;
+            result_allocations->bytes_allocated += result.context.size();
+        }
+        results.push_back(std::move(result));
+        if (result_allocations != nullptr && results.capacity() != capacity) {
+            result_allocations->allocations += 1;
+            result_allocations->bytes_allocated += results.capacity() * sizeof(cheatengine::MemoryScanner::SearchResult);
+            if (capacity != 0) {
+                result_allocations->deallocations += 1;
+            }
+        }
+        return true;
+    });
+}
+
+} // namespace
+
 namespace cheatengine {
 
+MemoryScanner::MemoryScanner(Resources resources)
+    : resources_(resources)
+{
+    if (resources_.results == nullptr) {
+        resources_.results = std::pmr::get_default_resource();
+    }
+    const mach_vm_size_t page_mask = read_engine_.pageSize() - 1;
+    resources_.chunk_size = std::max(resources_.chunk_size, read_engine_.pageSize());
+    resources_.chunk_size = (resources_.chunk_size + page_mask) & ~page_mask;
+}
+
 std::vector<MemoryRegion> MemoryScanner::enumerate(task_t task) const
 {
     std::vector<MemoryRegion> regions;
@@ -46,6 +147,8 @@ std::vector<MemoryRegion> MemoryScanner::enumerate(task_t task) const
         region.size = size;
         region.protection = info.protection;
         region.is_shared = (info.share_mode != SM_PRIVATE);
+        region.share_mode = info.share_mode;
+        region.pages_dirtied = info.pages_dirtied;
         region.category = categorizeRegion(info, address);
 
         regions.push_back(region);
@@ -53,93 +156,110 @@ std::vector<MemoryRegion> MemoryScanner::enumerate(task_t task) const
         address += size;
     }
 
+    read_engine_.observeRegions(task, regions);
     return regions;
 }
 
-std::vector<MemoryScanner::SearchResult> MemoryScanner::search(task_t task, const SearchValue& value) const
+MemoryScanner::ScanResults MemoryScanner::search(task_t task, const SearchValue& value) const
 {
-    std::vector<SearchResult> results;
-
-    if (task == MACH_PORT_NULL) {
-        return results;
-    }
-
-    const auto& needle = value.data();
-    if (needle.empty()) {
-        return results;
-    }
-
-    constexpr mach_vm_size_t chunk_size = 4096;
-    constexpr std::size_t context_bytes = 16;
+    auto arena = std::make_unique<std::pmr::monotonic_buffer_resource>(resources_.results);
+    ResultList results = search(task, value, arena.get());
+    return ScanResults{std::move(arena), std::move(results)};
+}
 
-    const auto regions = enumerate(task);
-    for (const auto& region : regions) {
-        if (!region.flags().readable) {
-            continue;
-        }
+MemoryScanner::ResultList MemoryScanner::search(task_t task,
+    const SearchValue& value,
+    std::pmr::memory_resource* arena,
+    ScanStats* stats) const
+{
+    CountingResource buffer_counter(bufferResource());
 
-        mach_vm_size_t offset = 0;
-        while (offset < region.size) {
-            mach_vm_size_t bytes_to_read =
-                std::min(chunk_size, region.size - offset);
+    ResultList results(arena != nullptr ? arena : resources_.results);
+    ReadEngine::Buffer buffer(&buffer_counter);
+    std::uint64_t bytes_scanned = 0;
+    AllocationStats result_allocations;
 
-            std::vector<std::uint8_t> buffer;
-            if (!readChunk(task, region.start_address + offset, bytes_to_read, buffer)) {
-                offset += bytes_to_read;
+    const auto& needle = value.data();
+    if (task != MACH_PORT_NULL && !needle.empty()) {
+        const auto regions = enumerate(task);
+        for (const auto& region : regions) {
+            if (!region.flags().readable) {
                 continue;
             }
+            scanRegion(task, region, needle, buffer, results, nullptr, &result_allocations);
+            bytes_scanned += region.size;
+        }
+    }
 
-            auto it = std::search(buffer.begin(), buffer.end(),
-                                  needle.begin(), needle.end());
-
-            while (it != buffer.end()) {
-                const auto match_index =
-                    static_cast<std::size_t>(std::distance(buffer.begin(), it));
-
-                const mach_vm_address_t match_address =
-                    region.start_address + offset + match_index;
-
-                const std::size_t context_start =
-                    (match_index > context_bytes)
-                        ? match_index - context_bytes
-                        : 0;
-
-                const std::size_t context_end =
-                    std::min(match_index + needle.size() + context_bytes,
-                             buffer.size());
+    if (stats != nullptr) {
+        stats->bytes_scanned = bytes_scanned;
+        stats->results = results.size();
+        stats->buffer_allocations = buffer_counter.stats();
+        stats->result_allocations = result_allocations;
+    }
 
-                using difference_type = std::vector<std::uint8_t>::difference_type;
-                auto start_it = buffer.begin();
-                std::advance(start_it, static_cast<difference_type>(context_start));
-                auto end_it = buffer.begin();
-                std::advance(end_it, static_cast<difference_type>(context_end));
+    return results;
+}
 
-                std::vector<std::uint8_t> context(start_it, end_it);
+void MemoryScanner::searchRegion(task_t task,
+    const MemoryRegion& region,
+    const SearchValue& value,
+    ResultList& results) const
+{
+    const auto& needle = value.data();
+    if (task == MACH_PORT_NULL || needle.empty() || !region.flags().readable) {
+        return;
+    }
 
-                SearchResult result;
-                result.address = match_address;
-                result.context = std::move(context);
-                result.value_size = needle.size();
-                results.push_back(std::move(result));
+    ReadEngine::Buffer buffer(bufferResource());
+    scanRegion(task, region, needle, buffer, results, nullptr);
+}
 
-                it = std::search(it + 1, buffer.end(),
-                                 needle.begin(), needle.end());
-            }
+bool MemoryScanner::scanRegion(task_t task,
+    const MemoryRegion& region,
+    const std::vector<std::uint8_t>& needle,
+    ReadEngine::Buffer& buffer,
+    ResultList& results,
+    const SliceCallback& on_slice,
+    AllocationStats* result_allocations) const
+{
+    const mach_vm_size_t chunk_size = resources_.chunk_size;
+    mach_vm_size_t offset = 0;
+    while (offset < region.size) {
+        mach_vm_size_t bytes_to_read =
+            std::min(chunk_size, region.size - offset);
+
+        read_engine_.read(task, region.start_address + offset, static_cast<std::size_t>(bytes_to_read), buffer);
+        for (const auto& span : buffer.spans) {
+            appendMatches(buffer.bytes, span, needle, region.start_address + offset, context_bytes, results, result_allocations);
+        }
 
-            if (region.size - offset <= chunk_size) {
-                break;
-            }
+        if (region.size - offset <= chunk_size) {
+            return !on_slice || on_slice(region.size - offset);
+        }
 
-            const mach_vm_size_t advance =
-                chunk_size > needle.size()
-                    ? chunk_size - static_cast<mach_vm_size_t>(needle.size() - 1)
-                    : chunk_size;
+        const mach_vm_size_t advance =
+            chunk_size > needle.size()
+                ? chunk_size - static_cast<mach_vm_size_t>(needle.size() - 1)
+                : chunk_size;
 
-            offset += advance;
+        offset += advance;
+        if (on_slice && !on_slice(advance)) {
+            return false;
         }
     }
 
-    return results;
+    return true;
+}
+
+ScanHandle MemoryScanner::searchAsync(task_t task, const SearchValue& value) const
+{
+    return searchAsync(task, value, ScanOptions{});
+}
+
+ScanHandle MemoryScanner::searchAsync(task_t task, const SearchValue& value, ScanOptions options) const
+{
+    return ScanHandle::start(*this, task, value, std::move(options));
 }
 
 bool MemoryScanner::readChunk(task_t task,
@@ -147,32 +267,20 @@ bool MemoryScanner::readChunk(task_t task,
     std::size_t size,
     std::vector<std::uint8_t>& buffer) const
 {
-    if (task == MACH_PORT_NULL || size == 0) {
-        buffer.clear();
-        return false;
-    }
-
-    buffer.resize(size);
-
-    mach_vm_size_t out_size = 0;
-
-    kern_return_t kr = mach_vm_read_overwrite(
-        task,
-        address,
-        static_cast<mach_vm_size_t>(size),
-        reinterpret_cast<mach_vm_address_t>(buffer.data()),
-        &out_size);
-
-    if (kr != KERN_SUCCESS || out_size == 0) {
-        buffer.clear();
-        return false;
-    }
+    return readInto(task, address, size, buffer);
+}
 
-    if (out_size < size) {
-        buffer.resize(static_cast<std::size_t>(out_size));
-    }
+bool MemoryScanner::readChunk(task_t task,
+    mach_vm_address_t address,
+    std::size_t size,
+    std::pmr::vector<std::uint8_t>& buffer) const
+{
+    return readInto(task, address, size, buffer);
+}
 
-    return true;
+std::pmr::memory_resource* MemoryScanner::bufferResource() const
+{
+    return resources_.buffers != nullptr ? resources_.buffers : threadBufferPool();
 }
 
 } // namespace cheatengine
@@ -0,0 +1,250 @@
+#include "cheatengine/memory/read_engine.hpp"
+
+#include <mach/mach_vm.h>
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+constexpr std::uint64_t fnv_offset = 0xCBF29CE484222325ULL;
+constexpr std::uint64_t fnv_prime = 0x100000001B3ULL;
+
+inline std::uint64_t fnvMix(std::uint64_t hash, std::uint64_t value)
+{
+    for (int i = 0; i < 8; ++i) {
+        hash ^= (value >> (i * 8)) & 0xFF;
+        hash *= fnv_prime;
+    }
+    return hash;
+}
+
+// Only failures that say the page itself is unmapped or unreadable are worth
+// remembering; anything else (a task mid-exec, a resource shortage) may well
+// succeed on the next pass.
+bool isPermanentFailure(kern_return_t kr)
+{
+    return kr == KERN_INVALID_ADDRESS || kr == KERN_PROTECTION_FAILURE;
+}
+
+void appendSpan(cheatengine::ReadEngine::Buffer& buffer, std::size_t offset, std::size_t size)
+{
+    if (!buffer.spans.empty()) {
+        auto& last = buffer.spans.back();
+        if (last.offset + last.size == offset) {
+            last.size += size;
+            return;
+        }
+    }
+    buffer.spans.push_back({offset, size});
+}
+
+} // namespace
+
+namespace cheatengine {
+
+ReadEngine::ReadEngine()
+    : page_size_(static_cast<mach_vm_size_t>(vm_page_size))
+    , page_mask_(static_cast<mach_vm_address_t>(vm_page_size) - 1)
+{
+}
+
+std::size_t ReadEngine::read(task_t task, mach_vm_address_t address, std::size_t size, Buffer& buffer)
+{
+    buffer.spans.clear();
+    if (task == MACH_PORT_NULL || size == 0) {
+        buffer.bytes.clear();
+        return 0;
+    }
+
+    buffer.bytes.resize(size);
+    reads_.fetch_add(1, std::memory_order_relaxed);
+
+    const mach_vm_address_t end = address + size;
+    if (cached_ranges_.load(std::memory_order_relaxed) == 0) {
+        readPiece(task, address, address, size, buffer);
+    } else {
+        mach_vm_address_t cursor = address;
+        while (cursor < end) {
+            mach_vm_address_t skip_start = end;
+            mach_vm_address_t skip_end = end;
+            if (nextUnreadable(task, cursor, end, skip_start, skip_end)) {
+                cache_hits_.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (skip_start > cursor) {
+                readPiece(task, address, cursor, skip_start - cursor, buffer);
+            }
+            cursor = skip_end;
+        }
+    }
+
+    std::size_t readable = 0;
+    for (const auto& span : buffer.spans) {
+        readable += span.size;
+    }
+    if (readable < size) {
+        bytes_recovered_.fetch_add(readable, std::memory_order_relaxed);
+    }
+    return readable;
+}
+
+void ReadEngine::readPiece(task_t task, mach_vm_address_t base, mach_vm_address_t address, mach_vm_size_t size, Buffer& buffer)
+{
+    const auto offset = static_cast<std::size_t>(address - base);
+    mach_vm_size_t out_size = 0;
+    const kern_return_t kr = mach_vm_read_overwrite(task,
+        address,
+        size,
+        reinterpret_cast<mach_vm_address_t>(buffer.bytes.data() + offset),
+        &out_size);
+
+    if (kr == KERN_SUCCESS && out_size > 0) {
+        out_size = std::min(out_size, size);
+        appendSpan(buffer, offset, static_cast<std::size_t>(out_size));
+        if (out_size < size) {
+            readPiece(task, base, address + out_size, size - out_size, buffer);
+        }
+        return;
+    }
+
+    // A fault is per page, so a piece that fits in one page is lost as a
+    // whole; anything larger is split on a page boundary and retried.
+    const mach_vm_address_t end = address + size;
+    const mach_vm_address_t first_page_end = (address & ~page_mask_) + page_size_;
+    if (end <= first_page_end) {
+        bytes_unreadable_.fetch_add(size, std::memory_order_relaxed);
+        if (isPermanentFailure(kr)) {
+            markUnreadable(task, address & ~page_mask_, first_page_end);
+        }
+        return;
+    }
+
+    split_reads_.fetch_add(1, std::memory_order_relaxed);
+    mach_vm_address_t middle = (address + size / 2) & ~page_mask_;
+    if (middle <= address) {
+        middle = first_page_end;
+    }
+    readPiece(task, base, address, middle - address, buffer);
+    readPiece(task, base, middle, end - middle, buffer);
+}
+
+bool ReadEngine::nextUnreadable(task_t task,
+    mach_vm_address_t from,
+    mach_vm_address_t end,
+    mach_vm_address_t& skip_start,
+    mach_vm_address_t& skip_end) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto cache = caches_.find(task);
+    if (cache == caches_.end()) {
+        return false;
+    }
+
+    const auto& ranges = cache->second.unreadable;
+    auto it = ranges.upper_bound(from);
+    if (it != ranges.begin()) {
+        auto previous = std::prev(it);
+        if (previous->second > from) {
+            skip_start = from;
+            skip_end = std::min(previous->second, end);
+            return true;
+        }
+    }
+    if (it != ranges.end() && it->first < end) {
+        skip_start = it->first;
+        skip_end = std::min(it->second, end);
+        return true;
+    }
+    return false;
+}
+
+void ReadEngine::markUnreadable(task_t task, mach_vm_address_t start, mach_vm_address_t end)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& ranges = caches_[task].unreadable;
+    const std::size_t before = ranges.size();
+
+    if (ranges.size() >= max_cached_ranges) {
+        ranges.clear();
+    }
+
+    auto it = ranges.upper_bound(start);
+    if (it != ranges.begin()) {
+        auto previous = std::prev(it);
+        if (previous->second >= start) {
+            start = previous->first;
+            end = std::max(end, previous->second);
+            it = ranges.erase(previous);
+        }
+    }
+    while (it != ranges.end() && it->first <= end) {
+        end = std::max(end, it->second);
+        it = ranges.erase(it);
+    }
+    ranges.emplace(start, end);
+
+    cached_ranges_.fetch_add(ranges.size(), std::memory_order_relaxed);
+    cached_ranges_.fetch_sub(before, std::memory_order_relaxed);
+}
+
+void ReadEngine::observeRegions(task_t task, const std::vector<MemoryRegion>& regions)
+{
+    std::uint64_t fingerprint = fnv_offset;
+    for (const auto& region : regions) {
+        fingerprint = fnvMix(fingerprint, region.start_address);
+        fingerprint = fnvMix(fingerprint, region.size);
+        fingerprint = fnvMix(fingerprint, static_cast<std::uint64_t>(region.protection));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& cache = caches_[task];
+    if (cache.has_fingerprint && cache.fingerprint != fingerprint && !cache.unreadable.empty()) {
+        cached_ranges_.fetch_sub(cache.unreadable.size(), std::memory_order_relaxed);
+        cache.unreadable.clear();
+        invalidations_.fetch_add(1, std::memory_order_relaxed);
+    }
+    cache.fingerprint = fingerprint;
+    cache.has_fingerprint = true;
+}
+
+void ReadEngine::invalidate(task_t task)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto cache = caches_.find(task);
+    if (cache == caches_.end()) {
+        return;
+    }
+    cached_ranges_.fetch_sub(cache->second.unreadable.size(), std::memory_order_relaxed);
+    caches_.erase(cache);
+    invalidations_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ReadEngine::invalidateAll()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    caches_.clear();
+    cached_ranges_.store(0, std::memory_order_relaxed);
+    invalidations_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool ReadEngine::knownUnreadable(task_t task, mach_vm_address_t address, std::size_t size) const
+{
+    mach_vm_address_t skip_start = 0;
+    mach_vm_address_t skip_end = 0;
+    return nextUnreadable(task, address, address + size, skip_start, skip_end)
+        && skip_start == address && skip_end == address + size;
+}
+
+ReadEngine::Stats ReadEngine::stats() const noexcept
+{
+    Stats stats;
+    stats.reads = reads_.load(std::memory_order_relaxed);
+    stats.split_reads = split_reads_.load(std::memory_order_relaxed);
+    stats.bytes_recovered = bytes_recovered_.load(std::memory_order_relaxed);
+    stats.bytes_unreadable = bytes_unreadable_.load(std::memory_order_relaxed);
+    stats.cache_hits = cache_hits_.load(std::memory_order_relaxed);
+    stats.invalidations = invalidations_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace cheatengine
@@ -0,0 +1,321 @@
+#include "cheatengine/memory/scan_handle.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace cheatengine {
+
+struct ScanHandle::State {
+    MemoryScanner::ScanOptions options;
+
+    std::atomic<bool> cancel_requested{false};
+    std::atomic<std::uint64_t> bytes_scanned{0};
+    std::atomic<std::uint64_t> bytes_total{0};
+    std::atomic<std::size_t> regions_completed{0};
+    std::atomic<std::size_t> regions_total{0};
+    std::atomic<std::size_t> results_found{0};
+
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<MemoryScanner::ResultBatch> queue;
+    Status status{Status::RUNNING};
+    std::exception_ptr error;
+    AllocationStats buffer_allocations;
+
+    std::thread worker;
+
+    void deliver(MemoryScanner::ResultBatch& batch)
+    {
+        if (batch.empty()) {
+            return;
+        }
+        results_found.fetch_add(batch.size(), std::memory_order_relaxed);
+
+        if (options.on_batch) {
+            options.on_batch(batch);
+            batch.clear();
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(std::move(batch));
+        }
+        batch = {};
+        cv.notify_all();
+    }
+
+    void publishAllocations(const AllocationStats& stats)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        buffer_allocations = stats;
+    }
+
+    void recordError(std::exception_ptr exception)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        error = std::move(exception);
+    }
+
+    void finish(Status final_status)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            status = final_status;
+        }
+        cv.notify_all();
+        if (options.on_complete) {
+            try {
+                options.on_complete();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    }
+};
+
+ScanHandle::ScanHandle(std::shared_ptr<State> state)
+    : state_(std::move(state))
+{
+}
+
+ScanHandle& ScanHandle::operator=(ScanHandle&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        state_ = std::move(other.state_);
+    }
+    return *this;
+}
+
+ScanHandle::~ScanHandle()
+{
+    release();
+}
+
+void ScanHandle::release() noexcept
+{
+    if (!state_) {
+        return;
+    }
+    state_->cancel_requested.store(true, std::memory_order_relaxed);
+    if (state_->worker.joinable()) {
+        state_->worker.join();
+    }
+    state_.reset();
+}
+
+ScanHandle ScanHandle::start(const MemoryScanner& scanner,
+    task_t task,
+    const SearchValue& value,
+    MemoryScanner::ScanOptions options)
+{
+    auto state = std::make_shared<State>();
+    state->options = std::move(options);
+    if (state->options.max_batch_results == 0) {
+        state->options.max_batch_results = 1;
+    }
+
+    if (state->options.result_resource == nullptr) {
+        state->options.result_resource = std::pmr::get_default_resource();
+    }
+
+    State* raw = state.get();
+    const MemoryScanner* scanner_ptr = &scanner;
+    std::vector<std::uint8_t> needle = value.data();
+
+    raw->worker = std::thread([raw, scanner_ptr, task, needle = std::move(needle)]() {
+        auto run = [&]() -> Status {
+            if (task == MACH_PORT_NULL || needle.empty()) {
+                return Status::COMPLETED;
+            }
+
+            std::vector<MemoryRegion> regions =
+                raw->options.regions ? std::move(*raw->options.regions) : scanner_ptr->enumerate(task);
+            regions.erase(std::remove_if(regions.begin(), regions.end(),
+                                         [](const MemoryRegion& region) { return !region.flags().readable; }),
+                          regions.end());
+
+            std::uint64_t total = 0;
+            for (const auto& region : regions) {
+                total += region.size;
+            }
+            raw->bytes_total.store(total, std::memory_order_relaxed);
+            raw->regions_total.store(regions.size(), std::memory_order_relaxed);
+
+            const auto& opts = raw->options;
+            MemoryScanner::ResultBatch pending(opts.result_resource);
+            // Resolved here so the default pool is the worker thread's own.
+            CountingResource buffer_counter(scanner_ptr->bufferResource());
+            ReadEngine::Buffer buffer(&buffer_counter);
+            auto last_flush = std::chrono::steady_clock::now();
+            Status stop_status = Status::COMPLETED;
+
+            auto keep_going = [&](std::chrono::steady_clock::time_point now) {
+                if (raw->cancel_requested.load(std::memory_order_relaxed)) {
+                    stop_status = Status::CANCELLED;
+                    return false;
+                }
+                if (opts.deadline && now >= *opts.deadline) {
+                    stop_status = Status::DEADLINE_EXCEEDED;
+                    return false;
+                }
+                return true;
+            };
+
+            auto on_slice = [&](mach_vm_size_t consumed) {
+                raw->bytes_scanned.fetch_add(consumed, std::memory_order_relaxed);
+
+                const auto now = std::chrono::steady_clock::now();
+                if (!pending.empty()
+                    && (pending.size() >= opts.max_batch_results || now - last_flush >= opts.flush_interval)) {
+                    raw->deliver(pending);
+                    last_flush = now;
+                }
+                return keep_going(now);
+            };
+
+            for (const auto& region : regions) {
+                if (!keep_going(std::chrono::steady_clock::now())
+                    || !scanner_ptr->scanRegion(task, region, needle, buffer, pending, on_slice)) {
+                    break;
+                }
+                raw->regions_completed.fetch_add(1, std::memory_order_relaxed);
+                raw->publishAllocations(buffer_counter.stats());
+                raw->deliver(pending);
+                last_flush = std::chrono::steady_clock::now();
+            }
+
+            raw->deliver(pending);
+            buffer.bytes.clear();
+            buffer.bytes.shrink_to_fit();
+            buffer.spans.clear();
+            buffer.spans.shrink_to_fit();
+            raw->publishAllocations(buffer_counter.stats());
+            return stop_status;
+        };
+
+        // An exception from on_batch (or the scan itself) must not escape the
+        // worker thread; it is surfaced as FAILED instead.
+        Status final_status = Status::FAILED;
+        try {
+            final_status = run();
+        } catch (...) {
+            raw->recordError(std::current_exception());
+        }
+        raw->finish(final_status);
+    });
+
+    return ScanHandle(std::move(state));
+}
+
+std::optional<MemoryScanner::ResultBatch> ScanHandle::next()
+{
+    if (!state_) {
+        return std::nullopt;
+    }
+
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    state_->cv.wait(lock, [this]() {
+        return !state_->queue.empty() || state_->status != Status::RUNNING;
+    });
+
+    if (state_->queue.empty()) {
+        return std::nullopt;
+    }
+    MemoryScanner::ResultBatch batch = std::move(state_->queue.front());
+    state_->queue.pop_front();
+    return batch;
+}
+
+std::optional<MemoryScanner::ResultBatch> ScanHandle::tryNext()
+{
+    if (!state_) {
+        return std::nullopt;
+    }
+
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    if (state_->queue.empty()) {
+        return std::nullopt;
+    }
+    MemoryScanner::ResultBatch batch = std::move(state_->queue.front());
+    state_->queue.pop_front();
+    return batch;
+}
+
+void ScanHandle::cancel() noexcept
+{
+    if (state_) {
+        state_->cancel_requested.store(true, std::memory_order_relaxed);
+    }
+}
+
+ScanHandle::Status ScanHandle::wait()
+{
+    if (!state_) {
+        return Status::CANCELLED;
+    }
+
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    state_->cv.wait(lock, [this]() { return state_->status != Status::RUNNING; });
+    return state_->status;
+}
+
+bool ScanHandle::waitFor(std::chrono::milliseconds timeout)
+{
+    if (!state_) {
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    return state_->cv.wait_for(lock, timeout, [this]() { return state_->status != Status::RUNNING; });
+}
+
+ScanHandle::Status ScanHandle::status() const
+{
+    if (!state_) {
+        return Status::CANCELLED;
+    }
+
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->status;
+}
+
+std::exception_ptr ScanHandle::error() const
+{
+    if (!state_) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->error;
+}
+
+ScanHandle::Progress ScanHandle::progress() const
+{
+    Progress progress;
+    if (!state_) {
+        return progress;
+    }
+
+    progress.bytes_scanned = state_->bytes_scanned.load(std::memory_order_relaxed);
+    progress.bytes_total = state_->bytes_total.load(std::memory_order_relaxed);
+    progress.regions_completed = state_->regions_completed.load(std::memory_order_relaxed);
+    progress.regions_total = state_->regions_total.load(std::memory_order_relaxed);
+    progress.results_found = state_->results_found.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    progress.buffer_allocations = state_->buffer_allocations;
+    return progress;
+}
+
+} // namespace cheatengine
@@ -0,0 +1,249 @@
+#include "cheatengine/monitor/region_monitor.hpp"
+
+#include <mach/mach_vm.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr std::size_t pages_per_read = 64;
+
+constexpr std::uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+constexpr std::uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr std::uint64_t prime3 = 0x165667B19E3779F9ULL;
+constexpr std::uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+
+inline std::uint64_t rotl(std::uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline std::uint64_t load64(const std::uint8_t* data)
+{
+    std::uint64_t value = 0;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+inline std::uint64_t mixLane(std::uint64_t lane, std::uint64_t input)
+{
+    return rotl(lane + input * prime2, 31) * prime1;
+}
+
+bool readRange(task_t task, mach_vm_address_t address, std::size_t size, std::uint8_t* out)
+{
+    mach_vm_size_t out_size = 0;
+    const kern_return_t kr = mach_vm_read_overwrite(task,
+        address,
+        static_cast<mach_vm_size_t>(size),
+        reinterpret_cast<mach_vm_address_t>(out),
+        &out_size);
+    return kr == KERN_SUCCESS && out_size == size;
+}
+
+} // namespace
+
+namespace cheatengine {
+
+RegionMonitor::RegionMonitor(std::size_t word_size)
+    : word_size_(word_size == 1 || word_size == 2 || word_size == 8 ? word_size : 4)
+    , page_size_(static_cast<std::size_t>(vm_page_size))
+{
+}
+
+void RegionMonitor::addRegion(const MemoryRegion& region)
+{
+    if (region.size == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& watched : regions_) {
+        if (watched.region.start_address == region.start_address) {
+            return;
+        }
+    }
+
+    const auto pages = static_cast<std::size_t>((region.size + page_size_ - 1) / page_size_);
+    WatchedRegion watched;
+    watched.region = region;
+    watched.snapshot.resize(static_cast<std::size_t>(region.size));
+    watched.hashes.assign(pages, 0);
+    watched.change_counts.assign(pages, 0);
+    watched.last_change.assign(pages, {});
+    watched.valid.assign(pages, false);
+    regions_.push_back(std::move(watched));
+}
+
+void RegionMonitor::removeRegion(mach_vm_address_t start_address)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    regions_.erase(std::remove_if(regions_.begin(), regions_.end(),
+                                  [start_address](const WatchedRegion& watched) {
+                                      return watched.region.start_address == start_address;
+                                  }),
+                   regions_.end());
+}
+
+void RegionMonitor::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    regions_.clear();
+}
+
+RegionMonitor::PassResult RegionMonitor::poll(task_t task)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    PassResult result;
+
+    if (task == MACH_PORT_NULL) {
+        return result;
+    }
+
+    for (auto& watched : regions_) {
+        pollRegion(task, watched, result);
+    }
+    return result;
+}
+
+void RegionMonitor::pollRegion(task_t task, WatchedRegion& watched, PassResult& result)
+{
+    const auto now = std::chrono::steady_clock::now();
+    const std::size_t region_size = static_cast<std::size_t>(watched.region.size);
+    const std::size_t page_count = watched.hashes.size();
+
+    buffer_.resize(pages_per_read * page_size_);
+
+    for (std::size_t first = 0; first < page_count; first += pages_per_read) {
+        const std::size_t last = std::min(first + pages_per_read, page_count);
+        const std::size_t offset = first * page_size_;
+        const std::size_t length = std::min(last * page_size_, region_size) - offset;
+
+        // One read per batch; fall back to single pages so a hole only costs
+        // the pages it covers.
+        const bool batch_ok = readRange(task, watched.region.start_address + offset, length, buffer_.data());
+
+        for (std::size_t page = first; page < last; ++page) {
+            const std::size_t page_offset = page * page_size_;
+            const std::size_t page_length = std::min(page_size_, region_size - page_offset);
+            std::uint8_t* current = buffer_.data() + (page_offset - offset);
+
+            if (!batch_ok
+                && !readRange(task, watched.region.start_address + page_offset, page_length, current)) {
+                watched.valid[page] = false;
+                continue;
+            }
+
+            ++result.pages_hashed;
+            const std::uint64_t hash = hashPage(current, page_length);
+
+            if (watched.valid[page]) {
+                if (hash == watched.hashes[page]) {
+                    continue;
+                }
+                ++result.pages_changed;
+                ++watched.change_counts[page];
+                watched.last_change[page] = now;
+                diffPage(watched, page, current, page_length, result);
+            }
+
+            std::memcpy(watched.snapshot.data() + page_offset, current, page_length);
+            watched.hashes[page] = hash;
+            watched.valid[page] = true;
+        }
+    }
+}
+
+void RegionMonitor::diffPage(const WatchedRegion& watched,
+    std::size_t page,
+    const std::uint8_t* current,
+    std::size_t size,
+    PassResult& result) const
+{
+    const std::size_t page_offset = page * page_size_;
+    const std::uint8_t* previous = watched.snapshot.data() + page_offset;
+
+    for (std::size_t offset = 0; offset + word_size_ <= size; offset += word_size_) {
+        if (std::memcmp(previous + offset, current + offset, word_size_) == 0) {
+            continue;
+        }
+
+        Candidate candidate;
+        candidate.address = watched.region.start_address + page_offset + offset;
+        std::memcpy(&candidate.old_value, previous + offset, word_size_);
+        std::memcpy(&candidate.new_value, current + offset, word_size_);
+        result.candidates.push_back(candidate);
+    }
+}
+
+std::vector<RegionMonitor::PageHeat> RegionMonitor::heatmap(std::uint32_t min_changes) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<PageHeat> heat;
+
+    for (const auto& watched : regions_) {
+        for (std::size_t page = 0; page < watched.change_counts.size(); ++page) {
+            if (watched.change_counts[page] < min_changes || watched.change_counts[page] == 0) {
+                continue;
+            }
+            PageHeat entry;
+            entry.address = watched.region.start_address + page * page_size_;
+            entry.change_count = watched.change_counts[page];
+            entry.last_change = watched.last_change[page];
+            heat.push_back(entry);
+        }
+    }
+
+    std::sort(heat.begin(), heat.end(), [](const PageHeat& lhs, const PageHeat& rhs) {
+        if (lhs.change_count != rhs.change_count) {
+            return lhs.change_count > rhs.change_count;
+        }
+        return lhs.address < rhs.address;
+    });
+    return heat;
+}
+
+void RegionMonitor::resetCounters()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& watched : regions_) {
+        std::fill(watched.change_counts.begin(), watched.change_counts.end(), 0);
+        std::fill(watched.last_change.begin(), watched.last_change.end(), std::chrono::steady_clock::time_point{});
+    }
+}
+
+// XXH64-style hash: four independent lanes consume 32 bytes per step, which
+// keeps the multiply units busy and lets the compiler vectorize the loop.
+std::uint64_t RegionMonitor::hashPage(const std::uint8_t* data, std::size_t size) noexcept
+{
+    std::uint64_t lanes[4] = {prime1 + prime2, prime2, 0, 0 - prime1};
+
+    std::size_t offset = 0;
+    for (; offset + 32 <= size; offset += 32) {
+        for (std::size_t lane = 0; lane < 4; ++lane) {
+            lanes[lane] = mixLane(lanes[lane], load64(data + offset + lane * 8));
+        }
+    }
+
+    std::uint64_t hash = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+    hash += static_cast<std::uint64_t>(size);
+
+    for (; offset + 8 <= size; offset += 8) {
+        hash ^= mixLane(0, load64(data + offset));
+        hash = rotl(hash, 27) * prime1 + prime4;
+    }
+    for (; offset < size; ++offset) {
+        hash ^= data[offset] * prime1;
+        hash = rotl(hash, 11) * prime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+} // namespace cheatengine
@@ -0,0 +1,425 @@
+#include "cheatengine/monitor/time_series.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// Worst case for one sample: a 4 + 64 bit timestamp and a 2 + 6 + 6 + 64 bit
+// value.
+constexpr std::size_t max_sample_bits = 146;
+
+inline std::uint64_t lowMask(unsigned bits)
+{
+    return bits >= 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << bits) - 1;
+}
+
+inline std::int64_t toMicros(std::chrono::steady_clock::time_point timestamp)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(timestamp.time_since_epoch()).count();
+}
+
+inline std::chrono::steady_clock::time_point fromMicros(std::int64_t micros)
+{
+    return std::chrono::steady_clock::time_point(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::microseconds(micros)));
+}
+
+inline unsigned leadingZeros(std::uint64_t value)
+{
+    return static_cast<unsigned>(__builtin_clzll(value));
+}
+
+inline unsigned trailingZeros(std::uint64_t value)
+{
+    return static_cast<unsigned>(__builtin_ctzll(value));
+}
+
+// Bits are packed most significant first within each word.
+template <typename Words>
+void writeBits(Words& words, std::size_t& bit_count, std::uint64_t value, unsigned bits)
+{
+    while (bits > 0) {
+        const std::size_t word = bit_count / 64;
+        const unsigned room = 64 - static_cast<unsigned>(bit_count % 64);
+        const unsigned take = std::min(room, bits);
+        const std::uint64_t part = (value >> (bits - take)) & lowMask(take);
+        words[word] |= part << (room - take);
+        bits -= take;
+        bit_count += take;
+    }
+}
+
+template <typename Words>
+class BitReader {
+public:
+    explicit BitReader(const Words& words)
+        : words_(words)
+    {
+    }
+
+    std::uint64_t read(unsigned bits)
+    {
+        std::uint64_t value = 0;
+        while (bits > 0) {
+            const std::size_t word = position_ / 64;
+            const unsigned used = static_cast<unsigned>(position_ % 64);
+            const unsigned take = std::min(64 - used, bits);
+            const std::uint64_t part = (words_[word] >> (64 - used - take)) & lowMask(take);
+            value = (take == 64 ? 0 : value << take) | part;
+            bits -= take;
+            position_ += take;
+        }
+        return value;
+    }
+
+    bool bit() { return read(1) != 0; }
+
+private:
+    const Words& words_;
+    std::size_t position_{0};
+};
+
+inline std::int64_t signExtend(std::uint64_t bits, std::size_t size)
+{
+    if (size >= 8) {
+        return static_cast<std::int64_t>(bits);
+    }
+    const unsigned width = static_cast<unsigned>(size * 8);
+    const std::uint64_t sign = std::uint64_t{1} << (width - 1);
+    bits &= lowMask(width);
+    return static_cast<std::int64_t>((bits ^ sign) - sign);
+}
+
+} // namespace
+
+namespace cheatengine {
+
+TimeSeriesStore::TimeSeriesStore()
+    : TimeSeriesStore(Retention{})
+{
+}
+
+TimeSeriesStore::TimeSeriesStore(Retention retention)
+    : retention_(retention)
+{
+}
+
+bool TimeSeriesStore::addSeries(mach_vm_address_t address, ValueType type)
+{
+    std::size_t size = 0;
+    switch (type) {
+    case ValueType::INT32:
+    case ValueType::FLOAT32:
+        size = 4;
+        break;
+    case ValueType::INT64:
+    case ValueType::FLOAT64:
+        size = 8;
+        break;
+    case ValueType::BYTES:
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& series = series_[address];
+    if (series.size != 0 && series.size != size) {
+        return false;
+    }
+    series.type = type;
+    series.size = size;
+    return true;
+}
+
+void TimeSeriesStore::removeSeries(mach_vm_address_t address)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    series_.erase(address);
+}
+
+void TimeSeriesStore::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    series_.clear();
+}
+
+bool TimeSeriesStore::contains(mach_vm_address_t address) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return series_.find(address) != series_.end();
+}
+
+bool TimeSeriesStore::append(mach_vm_address_t address,
+    Clock::time_point timestamp,
+    const std::uint8_t* data,
+    std::size_t size)
+{
+    if (data == nullptr || (size != 1 && size != 2 && size != 4 && size != 8)) {
+        return false;
+    }
+
+    std::uint64_t bits = 0;
+    std::memcpy(&bits, data, size);
+    const std::int64_t time = toMicros(timestamp);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& series = series_[address];
+    if (series.size == 0) {
+        series.size = size;
+    }
+    if (series.size != size) {
+        return false;
+    }
+    if (!series.chunks.empty() && time < series.previous_time) {
+        return false;
+    }
+
+    appendLocked(series, time, bits);
+    return true;
+}
+
+void TimeSeriesStore::appendLocked(Series& series, std::int64_t time, std::uint64_t bits)
+{
+    if (series.chunks.empty() || series.chunks.back()->bit_count + max_sample_bits > chunk_words * 64) {
+        series.chunks.push_back(std::make_unique<Chunk>());
+        auto& chunk = *series.chunks.back();
+        chunk.first_time = time;
+        chunk.last_time = time;
+        chunk.count = 1;
+        writeBits(chunk.words, chunk.bit_count, bits, static_cast<unsigned>(series.size * 8));
+
+        series.previous_time = time;
+        series.previous_delta = 0;
+        series.previous_bits = bits;
+        series.has_window = false;
+        trimLocked(series, time);
+        return;
+    }
+
+    auto& chunk = *series.chunks.back();
+
+    const std::int64_t delta = time - series.previous_time;
+    const std::int64_t dod = delta - series.previous_delta;
+    if (dod == 0) {
+        writeBits(chunk.words, chunk.bit_count, 0b0, 1);
+    } else if (dod >= -63 && dod <= 64) {
+        writeBits(chunk.words, chunk.bit_count, 0b10, 2);
+        writeBits(chunk.words, chunk.bit_count, static_cast<std::uint64_t>(dod + 63), 7);
+    } else if (dod >= -2047 && dod <= 2048) {
+        writeBits(chunk.words, chunk.bit_count, 0b110, 3);
+        writeBits(chunk.words, chunk.bit_count, static_cast<std::uint64_t>(dod + 2047), 12);
+    } else if (dod >= -524287 && dod <= 524288) {
+        writeBits(chunk.words, chunk.bit_count, 0b1110, 4);
+        writeBits(chunk.words, chunk.bit_count, static_cast<std::uint64_t>(dod + 524287), 20);
+    } else {
+        writeBits(chunk.words, chunk.bit_count, 0b1111, 4);
+        writeBits(chunk.words, chunk.bit_count, static_cast<std::uint64_t>(dod), 64);
+    }
+
+    const std::uint64_t diff = bits ^ series.previous_bits;
+    if (diff == 0) {
+        writeBits(chunk.words, chunk.bit_count, 0b0, 1);
+    } else {
+        const unsigned leading = std::min(leadingZeros(diff), 63u);
+        const unsigned trailing = trailingZeros(diff);
+        if (series.has_window && leading >= series.previous_leading && trailing >= series.previous_trailing) {
+            const unsigned meaningful = 64 - series.previous_leading - series.previous_trailing;
+            writeBits(chunk.words, chunk.bit_count, 0b10, 2);
+            writeBits(chunk.words, chunk.bit_count, diff >> series.previous_trailing, meaningful);
+        } else {
+            const unsigned meaningful = 64 - leading - trailing;
+            writeBits(chunk.words, chunk.bit_count, 0b11, 2);
+            writeBits(chunk.words, chunk.bit_count, leading, 6);
+            writeBits(chunk.words, chunk.bit_count, meaningful - 1, 6);
+            writeBits(chunk.words, chunk.bit_count, diff >> trailing, meaningful);
+            series.previous_leading = leading;
+            series.previous_trailing = trailing;
+            series.has_window = true;
+        }
+    }
+
+    chunk.last_time = time;
+    chunk.count += 1;
+    series.previous_time = time;
+    series.previous_delta = delta;
+    series.previous_bits = bits;
+}
+
+void TimeSeriesStore::trimLocked(Series& series, std::int64_t now) const
+{
+    const std::int64_t max_age = std::chrono::duration_cast<std::chrono::microseconds>(retention_.max_age).count();
+    std::size_t drop = 0;
+    while (series.chunks.size() - drop > 1) {
+        const bool too_many = retention_.max_chunks != 0 && series.chunks.size() - drop > retention_.max_chunks;
+        const bool too_old = series.chunks[drop]->last_time < now - max_age;
+        if (!too_many && !too_old) {
+            break;
+        }
+        ++drop;
+    }
+    series.chunks.erase(series.chunks.begin(), series.chunks.begin() + static_cast<std::ptrdiff_t>(drop));
+}
+
+template <typename Visitor>
+void TimeSeriesStore::decodeLocked(const Series& series, std::int64_t from, std::int64_t to, Visitor&& visit) const
+{
+    auto it = std::lower_bound(series.chunks.begin(), series.chunks.end(), from,
+                               [](const std::unique_ptr<Chunk>& candidate, std::int64_t time) { return candidate->last_time < time; });
+
+    for (; it != series.chunks.end() && (*it)->first_time <= to; ++it) {
+        const Chunk* chunk = it->get();
+        BitReader<decltype(chunk->words)> reader(chunk->words);
+
+        std::int64_t time = chunk->first_time;
+        std::int64_t delta = 0;
+        std::uint64_t bits = reader.read(static_cast<unsigned>(series.size * 8));
+        unsigned leading = 0;
+        unsigned trailing = 0;
+
+        for (std::uint32_t index = 0; index < chunk->count; ++index) {
+            if (index > 0) {
+                std::int64_t dod = 0;
+                if (!reader.bit()) {
+                    dod = 0;
+                } else if (!reader.bit()) {
+                    dod = static_cast<std::int64_t>(reader.read(7)) - 63;
+                } else if (!reader.bit()) {
+                    dod = static_cast<std::int64_t>(reader.read(12)) - 2047;
+                } else if (!reader.bit()) {
+                    dod = static_cast<std::int64_t>(reader.read(20)) - 524287;
+                } else {
+                    dod = static_cast<std::int64_t>(reader.read(64));
+                }
+                delta += dod;
+                time += delta;
+
+                if (reader.bit()) {
+                    if (reader.bit()) {
+                        leading = static_cast<unsigned>(reader.read(6));
+                        const unsigned meaningful = static_cast<unsigned>(reader.read(6)) + 1;
+                        trailing = 64 - leading - meaningful;
+                    }
+                    const unsigned meaningful = 64 - leading - trailing;
+                    bits ^= reader.read(meaningful) << trailing;
+                }
+            }
+
+            if (time > to) {
+                return;
+            }
+            if (time >= from) {
+                visit(time, bits);
+            }
+        }
+    }
+}
+
+std::vector<TimeSeriesStore::Sample> TimeSeriesStore::range(mach_vm_address_t address,
+    Clock::time_point from,
+    Clock::time_point to) const
+{
+    std::vector<Sample> samples;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = series_.find(address);
+    if (it == series_.end()) {
+        return samples;
+    }
+
+    decodeLocked(it->second, toMicros(from), toMicros(to), [&samples](std::int64_t time, std::uint64_t bits) {
+        samples.push_back({fromMicros(time), bits});
+    });
+    return samples;
+}
+
+std::vector<TimeSeriesStore::Bucket> TimeSeriesStore::downsample(mach_vm_address_t address,
+    Clock::time_point from,
+    Clock::time_point to,
+    Clock::duration step) const
+{
+    std::vector<Bucket> buckets;
+    const std::int64_t step_micros = std::chrono::duration_cast<std::chrono::microseconds>(step).count();
+    if (step_micros <= 0) {
+        return buckets;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = series_.find(address);
+    if (it == series_.end()) {
+        return buckets;
+    }
+
+    const auto& series = it->second;
+    const std::int64_t origin = toMicros(from);
+    std::int64_t current = std::numeric_limits<std::int64_t>::min();
+    double sum = 0.0;
+
+    decodeLocked(series, origin, toMicros(to), [&](std::int64_t time, std::uint64_t bits) {
+        const double value = toDouble(series.type, series.size, bits);
+        const std::int64_t index = (time - origin) / step_micros;
+        if (buckets.empty() || index != current) {
+            if (!buckets.empty()) {
+                buckets.back().mean = sum / static_cast<double>(buckets.back().count);
+            }
+            current = index;
+            sum = 0.0;
+            buckets.push_back({fromMicros(origin + index * step_micros), 0, value, value, 0.0, value});
+        }
+
+        auto& bucket = buckets.back();
+        bucket.count += 1;
+        bucket.min = std::min(bucket.min, value);
+        bucket.max = std::max(bucket.max, value);
+        bucket.last = value;
+        sum += value;
+    });
+
+    if (!buckets.empty()) {
+        buckets.back().mean = sum / static_cast<double>(buckets.back().count);
+    }
+    return buckets;
+}
+
+void TimeSeriesStore::enforceRetention(Clock::time_point now)
+{
+    const std::int64_t time = toMicros(now);
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : series_) {
+        trimLocked(entry.second, time);
+    }
+}
+
+TimeSeriesStore::Stats TimeSeriesStore::stats() const
+{
+    Stats stats;
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.series = series_.size();
+    for (const auto& entry : series_) {
+        for (const auto& chunk : entry.second.chunks) {
+            stats.chunks += 1;
+            stats.samples += chunk->count;
+            stats.encoded_bytes += (chunk->bit_count + 7) / 8;
+            stats.reserved_bytes += sizeof(Chunk);
+        }
+    }
+    return stats;
+}
+
+double TimeSeriesStore::toDouble(ValueType type, std::size_t size, std::uint64_t bits) noexcept
+{
+    if (type == ValueType::FLOAT32 && size == sizeof(float)) {
+        float value = 0.0f;
+        const auto narrow = static_cast<std::uint32_t>(bits);
+        std::memcpy(&value, &narrow, sizeof(value));
+        return static_cast<double>(value);
+    }
+    if (type == ValueType::FLOAT64 && size == sizeof(double)) {
+        double value = 0.0;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    return static_cast<double>(signExtend(bits, size));
+}
+
+} // namespace cheatengine
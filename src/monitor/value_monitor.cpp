@@ -6,7 +6,7 @@
 
 namespace {
 bool readValue(task_t task, mach_vm_address_t address, std::size_t size,
-               std::vector<std::uint8_t>& buffer)
+               std::pmr::vector<std::uint8_t>& buffer)
 {
     buffer.resize(size);
     mach_vm_size_t out_size = 0;
@@ -26,10 +26,26 @@ bool readValue(task_t task, mach_vm_address_t address, std::size_t size,
 
 namespace cheatengine {
 
+ValueMonitor::ValueMonitor(std::pmr::memory_resource* resource)
+    : resource_(resource)
+{
+}
+
 void ValueMonitor::addAddress(mach_vm_address_t address, std::size_t size)
 {
     std::lock_guard<std::mutex> lock(mutex_);
-    addresses_.push_back({address, size, {}, std::chrono::steady_clock::now()});
+    addAddressLocked(address, size);
+
+    if (watchpoints_) {
+        armAvailableLocked();
+    }
+}
+
+void ValueMonitor::addAddressLocked(mach_vm_address_t address, std::size_t size)
+{
+    MonitoredAddress entry{address, size, std::pmr::vector<std::uint8_t>(&resource_), std::chrono::steady_clock::now(), false};
+    entry.last_value.reserve(size);
+    addresses_.push_back(std::move(entry));
 }
 
 void ValueMonitor::removeAddress(mach_vm_address_t address)
@@ -38,43 +54,73 @@ void ValueMonitor::removeAddress(mach_vm_address_t address)
     addresses_.erase(std::remove_if(addresses_.begin(), addresses_.end(),
                                     [address](const MonitoredAddress& entry) { return entry.address == address; }),
                      addresses_.end());
+
+    if (watchpoints_) {
+        watchpoints_->disarm(address);
+        armAvailableLocked();
+    }
 }
 
-std::vector<ValueMonitor::ValueChange> ValueMonitor::poll(task_t task)
+std::vector<ValueMonitor::ValueChange> ValueMonitor::poll(task_t task, std::pmr::memory_resource* resource)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
     std::vector<ValueChange> changes;
+    poll(task, changes, resource);
+    return changes;
+}
+
+void ValueMonitor::poll(task_t task, std::vector<ValueChange>& changes, std::pmr::memory_resource* resource)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    changes.clear();
+
+    // One timestamp per pass keeps the delta-of-delta encoding at a bit per
+    // sample for a steady poll rate. It is taken before the watchpoint queue
+    // is drained: events are stamped and queued under the watchpoint lock, so
+    // anything left for the next drain is newer than this pass's samples and
+    // the history never sees an address go back in time.
+    const auto sampled_at = history_ != nullptr ? std::chrono::steady_clock::now()
+                                                : std::chrono::steady_clock::time_point{};
+
+    if (watchpoints_) {
+        collectWatchpointEventsLocked(changes, resource);
+    }
 
     if (task == MACH_PORT_NULL) {
-        return changes;
+        return;
     }
 
     for (auto& entry : addresses_){
-        std::vector<std::uint8_t> current;
-        if (!readValue(task, entry.address, entry.value_size, current)) {
+        if (entry.hardware_watched && !entry.last_value.empty()) {
             continue;
         }
 
-        if (entry.last_value.empty()) {
-            entry.last_value = current;
-            entry.last_update = std::chrono::steady_clock::now();
+        if (!readValue(task, entry.address, entry.value_size, scratch_)) {
             continue;
         }
 
-        if (current != entry.last_value) {
-            ValueChange change;
-            change.address = entry.address;
-            change.old_value = entry.last_value;
-            change.new_value = current;
-            change.timestamp = std::chrono::steady_clock::now();
-            changes.push_back(std::move(change));
+        if (history_ != nullptr) {
+            history_->append(entry.address, sampled_at, scratch_.data(), scratch_.size());
+        }
 
-            entry.last_value = std::move(current);
+        if (entry.last_value.empty()) {
+            entry.last_value.assign(scratch_.begin(), scratch_.end());
             entry.last_update = std::chrono::steady_clock::now();
+            continue;
         }
-    }
 
-    return changes;
+        if (scratch_ != entry.last_value) {
+            const auto now = std::chrono::steady_clock::now();
+            changes.push_back({entry.address,
+                               std::pmr::vector<std::uint8_t>(entry.last_value, resource),
+                               std::pmr::vector<std::uint8_t>(scratch_, resource),
+                               now,
+                               0,
+                               0});
+
+            entry.last_value.assign(scratch_.begin(), scratch_.end());
+            entry.last_update = now;
+        }
+    }
 }
 
 std::vector<ValueMonitor::MonitoredAddress> ValueMonitor::tracked() const
@@ -83,4 +129,113 @@ std::vector<ValueMonitor::MonitoredAddress> ValueMonitor::tracked() const
     return addresses_;
 }
 
+void ValueMonitor::watchCandidates(const RegionMonitor::PassResult& pass, std::size_t value_size)
+{
+    // One lock for the whole pass, so a concurrent addAddress() cannot slip
+    // in between the lookup and the insert and leave a duplicate.
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& candidate : pass.candidates) {
+        const bool known = std::any_of(addresses_.begin(), addresses_.end(), [&candidate](const MonitoredAddress& entry) {
+            return entry.address == candidate.address;
+        });
+        if (!known) {
+            addAddressLocked(candidate.address, value_size);
+        }
+    }
+
+    if (watchpoints_) {
+        armAvailableLocked();
+    }
+}
+
+void ValueMonitor::setHistory(TimeSeriesStore* history)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    history_ = history;
+}
+
+bool ValueMonitor::enableWatchpoints(task_t task)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (watchpoints_) {
+        return true;
+    }
+    if (!WatchpointMonitor::supported() || task == MACH_PORT_NULL) {
+        return false;
+    }
+
+    auto watchpoints = std::make_unique<WatchpointMonitor>();
+    if (!watchpoints->start(task)) {
+        return false;
+    }
+    watchpoints_ = std::move(watchpoints);
+    armAvailableLocked();
+    return true;
+}
+
+void ValueMonitor::disableWatchpoints()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!watchpoints_) {
+        return;
+    }
+
+    watchpoints_->stop();
+    watchpoints_.reset();
+    for (auto& entry : addresses_) {
+        entry.hardware_watched = false;
+    }
+}
+
+bool ValueMonitor::watchpointsEnabled() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return watchpoints_ != nullptr;
+}
+
+void ValueMonitor::armAvailableLocked()
+{
+    for (auto& entry : addresses_) {
+        if (watchpoints_->freeSlots() == 0) {
+            return;
+        }
+        if (!entry.hardware_watched && watchpoints_->arm(entry.address, entry.value_size)) {
+            entry.hardware_watched = true;
+        }
+    }
+}
+
+void ValueMonitor::collectWatchpointEventsLocked(std::vector<ValueChange>& changes,
+    std::pmr::memory_resource* resource)
+{
+    events_.clear();
+    watchpoints_->drain(events_);
+
+    for (const auto& event : events_) {
+        auto entry = std::find_if(addresses_.begin(), addresses_.end(), [&event](const MonitoredAddress& candidate) {
+            return candidate.hardware_watched && candidate.address == event.address;
+        });
+        if (entry == addresses_.end()) {
+            continue;
+        }
+
+        const auto* value_begin = event.value.data();
+        const auto* value_end = value_begin + event.size;
+        if (history_ != nullptr) {
+            history_->append(entry->address, event.timestamp, value_begin, event.size);
+        }
+        if (!entry->last_value.empty()) {
+            changes.push_back({entry->address,
+                               std::pmr::vector<std::uint8_t>(entry->last_value, resource),
+                               std::pmr::vector<std::uint8_t>(value_begin, value_end, resource),
+                               event.timestamp,
+                               event.instruction_pointer,
+                               event.thread_id});
+        }
+
+        entry->last_value.assign(value_begin, value_end);
+        entry->last_update = event.timestamp;
+    }
+}
+
 } // namespace cheatengine
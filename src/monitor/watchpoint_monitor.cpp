@@ -0,0 +1,483 @@
+#include "cheatengine/monitor/watchpoint_monitor.hpp"
+
+#include <mach/mach_vm.h>
+#include <mach/thread_status.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+#if defined(__x86_64__)
+
+constexpr mach_msg_id_t exception_raise_id = 2401;
+constexpr mach_msg_id_t mach_exception_raise_id = 2405;
+constexpr mach_msg_timeout_t listen_timeout_ms = 100;
+constexpr std::uint64_t dr6_hit_mask = 0xF;
+
+#pragma pack(push, 4)
+// Layouts of the MIG-generated mach_exception_raise request and reply
+// (mach_exc.defs), written out so no generated stubs are needed.
+struct ExceptionRaiseRequest {
+    mach_msg_header_t header;
+    mach_msg_body_t body;
+    mach_msg_port_descriptor_t thread;
+    mach_msg_port_descriptor_t task;
+    NDR_record_t ndr;
+    exception_type_t exception;
+    mach_msg_type_number_t code_count;
+    std::int64_t code[2];
+    mach_msg_trailer_t trailer;
+};
+
+struct ExceptionRaiseReply {
+    mach_msg_header_t header;
+    NDR_record_t ndr;
+    kern_return_t return_code;
+};
+#pragma pack(pop)
+
+// DR7 encoding for slot `index`: local enable, break on data writes, and the
+// length field (00 = 1, 01 = 2, 11 = 4, 10 = 8 bytes).
+std::uint64_t dr7Bits(std::size_t index, std::size_t size)
+{
+    std::uint64_t length = 0;
+    switch (size) {
+    case 2:
+        length = 0x1;
+        break;
+    case 4:
+        length = 0x3;
+        break;
+    case 8:
+        length = 0x2;
+        break;
+    default:
+        length = 0x0;
+        break;
+    }
+
+    const std::uint64_t control = 0x1 | (length << 2);
+    return (std::uint64_t{1} << (index * 2)) | (control << (16 + index * 4));
+}
+
+kern_return_t receiveException(mach_port_t port, ExceptionRaiseRequest& request, mach_msg_timeout_t timeout)
+{
+    std::memset(&request, 0, sizeof(request));
+    return mach_msg(&request.header,
+        MACH_RCV_MSG | MACH_RCV_TIMEOUT,
+        0,
+        sizeof(request),
+        port,
+        timeout,
+        MACH_PORT_NULL);
+}
+
+void replyToException(const ExceptionRaiseRequest& request, kern_return_t result)
+{
+    ExceptionRaiseReply reply{};
+    reply.header.msgh_bits = MACH_MSGH_BITS(MACH_MSGH_BITS_REMOTE(request.header.msgh_bits), 0);
+    reply.header.msgh_remote_port = request.header.msgh_remote_port;
+    reply.header.msgh_local_port = MACH_PORT_NULL;
+    reply.header.msgh_id = request.header.msgh_id + 100;
+    reply.header.msgh_size = sizeof(reply);
+    reply.ndr = NDR_record;
+    reply.return_code = result;
+    mach_msg(&reply.header, MACH_SEND_MSG, sizeof(reply), 0, MACH_PORT_NULL, MACH_MSG_TIMEOUT_NONE, MACH_PORT_NULL);
+
+    mach_port_deallocate(mach_task_self(), request.thread.name);
+    mach_port_deallocate(mach_task_self(), request.task.name);
+}
+
+// Hands an exception that is not ours to the handler it displaced, moving the
+// kernel's reply port along so that handler answers the kernel directly.
+// Only EXCEPTION_DEFAULT handlers can be served this way; the state-carrying
+// behaviours would need the thread state fetched and sent with it.
+bool forwardException(ExceptionRaiseRequest& request, mach_port_t handler, exception_behavior_t behavior)
+{
+    if (!MACH_PORT_VALID(handler) || (behavior & ~MACH_EXCEPTION_CODES) != EXCEPTION_DEFAULT) {
+        return false;
+    }
+
+    const mach_msg_header_t received = request.header;
+    const mach_msg_port_descriptor_t thread = request.thread;
+    const mach_msg_port_descriptor_t task = request.task;
+
+    request.header.msgh_bits = MACH_MSGH_BITS_COMPLEX
+        | MACH_MSGH_BITS(MACH_MSG_TYPE_COPY_SEND, MACH_MSG_TYPE_MOVE_SEND_ONCE);
+    request.header.msgh_remote_port = handler;
+    request.header.msgh_local_port = received.msgh_remote_port;
+    request.thread.disposition = MACH_MSG_TYPE_MOVE_SEND;
+    request.task.disposition = MACH_MSG_TYPE_MOVE_SEND;
+
+    if ((behavior & MACH_EXCEPTION_CODES) == 0) {
+        // exception_raise carries the codes as 32-bit values.
+        const std::int32_t narrow[2] = {static_cast<std::int32_t>(request.code[0]), static_cast<std::int32_t>(request.code[1])};
+        std::memcpy(request.code, narrow, sizeof(narrow));
+        request.header.msgh_size -= static_cast<mach_msg_size_t>(sizeof(narrow));
+        request.header.msgh_id = exception_raise_id;
+    }
+
+    const kern_return_t kr = mach_msg(&request.header,
+        MACH_SEND_MSG | MACH_SEND_TIMEOUT,
+        request.header.msgh_size,
+        0,
+        MACH_PORT_NULL,
+        listen_timeout_ms,
+        MACH_PORT_NULL);
+    if (kr != KERN_SUCCESS) {
+        // Unsent rights stay with us; answer the kernel ourselves.
+        request.header = received;
+        request.thread = thread;
+        request.task = task;
+        return false;
+    }
+    return true;
+}
+
+std::uint64_t threadId(mach_port_t thread)
+{
+    thread_identifier_info_data_t info{};
+    mach_msg_type_number_t count = THREAD_IDENTIFIER_INFO_COUNT;
+    if (thread_info(thread, THREAD_IDENTIFIER_INFO, reinterpret_cast<thread_info_t>(&info), &count) != KERN_SUCCESS) {
+        return 0;
+    }
+    return info.thread_id;
+}
+
+std::uint64_t instructionPointer(mach_port_t thread)
+{
+    x86_thread_state64_t state{};
+    mach_msg_type_number_t count = x86_THREAD_STATE64_COUNT;
+    if (thread_get_state(thread, x86_THREAD_STATE64, reinterpret_cast<thread_state_t>(&state), &count) != KERN_SUCCESS) {
+        return 0;
+    }
+    return state.__rip;
+}
+
+#endif
+
+} // namespace
+
+namespace cheatengine {
+
+WatchpointMonitor::~WatchpointMonitor()
+{
+    stop();
+}
+
+bool WatchpointMonitor::supported() noexcept
+{
+#if defined(__x86_64__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool WatchpointMonitor::canWatch(mach_vm_address_t address, std::size_t size) noexcept
+{
+    if (!supported()) {
+        return false;
+    }
+    if (size != 1 && size != 2 && size != 4 && size != 8) {
+        return false;
+    }
+    return address % size == 0;
+}
+
+#if defined(__x86_64__)
+
+bool WatchpointMonitor::start(task_t task)
+{
+    if (running_.load() || task == MACH_PORT_NULL) {
+        return running_.load();
+    }
+
+    mach_port_t port = MACH_PORT_NULL;
+    if (mach_port_allocate(mach_task_self(), MACH_PORT_RIGHT_RECEIVE, &port) != KERN_SUCCESS) {
+        return false;
+    }
+    if (mach_port_insert_right(mach_task_self(), port, port, MACH_MSG_TYPE_MAKE_SEND) != KERN_SUCCESS) {
+        mach_port_mod_refs(mach_task_self(), port, MACH_PORT_RIGHT_RECEIVE, -1);
+        return false;
+    }
+
+    saved_ = {};
+    saved_.count = EXC_TYPES_COUNT;
+    const kern_return_t kr = task_swap_exception_ports(task,
+        EXC_MASK_BREAKPOINT,
+        port,
+        static_cast<exception_behavior_t>(EXCEPTION_DEFAULT | MACH_EXCEPTION_CODES),
+        THREAD_STATE_NONE,
+        saved_.masks.data(),
+        &saved_.count,
+        saved_.ports.data(),
+        saved_.behaviors.data(),
+        saved_.flavors.data());
+    if (kr != KERN_SUCCESS) {
+        mach_port_deallocate(mach_task_self(), port);
+        mach_port_mod_refs(mach_task_self(), port, MACH_PORT_RIGHT_RECEIVE, -1);
+        return false;
+    }
+
+    task_ = task;
+    exception_port_ = port;
+    running_.store(true);
+    applyDebugState();
+    listener_ = std::thread([this]() { listen(); });
+    return true;
+}
+
+void WatchpointMonitor::stop()
+{
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    if (listener_.joinable()) {
+        listener_.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        slots_ = {};
+        applyDebugStateLocked();
+    }
+
+    for (mach_msg_type_number_t i = 0; i < saved_.count; ++i) {
+        task_set_exception_ports(task_, saved_.masks[i], saved_.ports[i], saved_.behaviors[i], saved_.flavors[i]);
+        if (saved_.ports[i] != MACH_PORT_NULL) {
+            mach_port_deallocate(mach_task_self(), saved_.ports[i]);
+        }
+    }
+    saved_ = {};
+
+    // Threads that trapped before the registers were cleared are still
+    // waiting on us; resume them rather than letting the port die under them.
+    ExceptionRaiseRequest pending{};
+    while (receiveException(exception_port_, pending, 0) == KERN_SUCCESS) {
+        replyToException(pending, KERN_SUCCESS);
+    }
+
+    mach_port_deallocate(mach_task_self(), exception_port_);
+    mach_port_mod_refs(mach_task_self(), exception_port_, MACH_PORT_RIGHT_RECEIVE, -1);
+    exception_port_ = MACH_PORT_NULL;
+    task_ = MACH_PORT_NULL;
+}
+
+bool WatchpointMonitor::arm(mach_vm_address_t address, std::size_t size)
+{
+    if (!canWatch(address, size)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find_if(slots_.begin(), slots_.end(), [](const Slot& slot) { return !slot.active; });
+    if (it == slots_.end()) {
+        return false;
+    }
+
+    *it = {address, size, true};
+    if (running_.load()) {
+        applyDebugStateLocked();
+    }
+    return true;
+}
+
+void WatchpointMonitor::disarm(mach_vm_address_t address)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& slot : slots_) {
+        if (slot.active && slot.address == address) {
+            slot = {};
+        }
+    }
+    if (running_.load()) {
+        applyDebugStateLocked();
+    }
+}
+
+void WatchpointMonitor::applyDebugState()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    applyDebugStateLocked();
+}
+
+void WatchpointMonitor::applyDebugStateLocked()
+{
+    if (task_ == MACH_PORT_NULL) {
+        return;
+    }
+
+    x86_debug_state64_t state{};
+    std::uint64_t* address_registers[max_watchpoints] = {&state.__dr0, &state.__dr1, &state.__dr2, &state.__dr3};
+    for (std::size_t i = 0; i < slots_.size(); ++i) {
+        if (slots_[i].active) {
+            *address_registers[i] = slots_[i].address;
+            state.__dr7 |= dr7Bits(i, slots_[i].size);
+        }
+    }
+
+    // The task-wide state is inherited by threads created from now on; the
+    // per-thread pass covers the threads that already exist.
+    task_set_state(task_, x86_DEBUG_STATE64, reinterpret_cast<thread_state_t>(&state), x86_DEBUG_STATE64_COUNT);
+
+    thread_act_array_t threads = nullptr;
+    mach_msg_type_number_t thread_count = 0;
+    if (task_threads(task_, &threads, &thread_count) != KERN_SUCCESS) {
+        return;
+    }
+
+    for (mach_msg_type_number_t i = 0; i < thread_count; ++i) {
+        thread_set_state(threads[i], x86_DEBUG_STATE64, reinterpret_cast<thread_state_t>(&state), x86_DEBUG_STATE64_COUNT);
+        mach_port_deallocate(mach_task_self(), threads[i]);
+    }
+    mach_vm_deallocate(mach_task_self(),
+        reinterpret_cast<mach_vm_address_t>(threads),
+        static_cast<mach_vm_size_t>(thread_count * sizeof(thread_act_t)));
+}
+
+void WatchpointMonitor::listen()
+{
+    ExceptionRaiseRequest request{};
+
+    while (running_.load()) {
+        // The timeout only bounds how long stop() waits; new threads inherit
+        // the task-wide debug state, so there is nothing to re-arm here.
+        if (receiveException(exception_port_, request, listen_timeout_ms) != KERN_SUCCESS) {
+            continue;
+        }
+
+        // A data watchpoint arrives as EXC_I386_SGL with the break address,
+        // not DR6, in its subcode; only the thread's own DR6 tells our hits
+        // from a debugger's single-step.
+        bool handled = false;
+        if (request.header.msgh_id == mach_exception_raise_id && request.exception == EXC_BREAKPOINT) {
+            handled = handleException(request.thread.name);
+        }
+
+        if (handled) {
+            replyToException(request, KERN_SUCCESS);
+            continue;
+        }
+
+        // Breakpoints that are not ours (a debugger's int3, say) belong to
+        // whichever task-level handler we displaced in start().
+        bool forwarded = false;
+        for (mach_msg_type_number_t i = 0; i < saved_.count; ++i) {
+            if ((saved_.masks[i] & EXC_MASK_BREAKPOINT) != 0) {
+                forwarded = forwardException(request, saved_.ports[i], saved_.behaviors[i]);
+                break;
+            }
+        }
+        if (!forwarded) {
+            // Nobody else to ask; the kernel moves on to the host handler.
+            replyToException(request, KERN_FAILURE);
+        }
+    }
+}
+
+bool WatchpointMonitor::handleException(mach_port_t thread)
+{
+    // Held across the read-modify-write of the thread's debug registers so a
+    // concurrent arm() or disarm() is not overwritten with stale slots.
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    x86_debug_state64_t debug{};
+    mach_msg_type_number_t count = x86_DEBUG_STATE64_COUNT;
+    if (thread_get_state(thread, x86_DEBUG_STATE64, reinterpret_cast<thread_state_t>(&debug), &count) != KERN_SUCCESS) {
+        return false;
+    }
+
+    std::uint64_t ours = 0;
+    for (std::size_t i = 0; i < slots_.size(); ++i) {
+        if (slots_[i].active) {
+            ours |= std::uint64_t{1} << i;
+        }
+    }
+    const std::uint64_t hits = debug.__dr6 & dr6_hit_mask & ours;
+    if (hits == 0) {
+        return false;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    const std::uint64_t ip = instructionPointer(thread);
+    const std::uint64_t tid = threadId(thread);
+
+    for (std::size_t i = 0; i < slots_.size(); ++i) {
+        if ((hits & (std::uint64_t{1} << i)) == 0) {
+            continue;
+        }
+
+        WriteEvent event;
+        event.address = slots_[i].address;
+        event.size = slots_[i].size;
+        event.instruction_pointer = ip;
+        event.thread_id = tid;
+        event.timestamp = now;
+
+        // The writing thread is suspended in the exception, so this read
+        // observes exactly the value it stored.
+        mach_vm_size_t out_size = 0;
+        mach_vm_read_overwrite(task_,
+            event.address,
+            event.size,
+            reinterpret_cast<mach_vm_address_t>(event.value.data()),
+            &out_size);
+        if (out_size == event.size) {
+            events_.push_back(event);
+        }
+    }
+
+    // Only our status bits are cleared; a debugger's single-step bit stays.
+    debug.__dr6 &= ~hits;
+    thread_set_state(thread, x86_DEBUG_STATE64, reinterpret_cast<thread_state_t>(&debug), x86_DEBUG_STATE64_COUNT);
+    return true;
+}
+
+#else
+
+bool WatchpointMonitor::start(task_t)
+{
+    return false;
+}
+
+void WatchpointMonitor::stop()
+{
+    running_.store(false);
+}
+
+bool WatchpointMonitor::arm(mach_vm_address_t, std::size_t)
+{
+    return false;
+}
+
+void WatchpointMonitor::disarm(mach_vm_address_t)
+{
+}
+
+#endif
+
+bool WatchpointMonitor::isArmed(mach_vm_address_t address) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return std::any_of(slots_.begin(), slots_.end(),
+                       [address](const Slot& slot) { return slot.active && slot.address == address; });
+}
+
+std::size_t WatchpointMonitor::freeSlots() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<std::size_t>(std::count_if(slots_.begin(), slots_.end(),
+                                                  [](const Slot& slot) { return !slot.active; }));
+}
+
+void WatchpointMonitor::drain(std::vector<WriteEvent>& events)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    events.insert(events.end(), events_.begin(), events_.end());
+    events_.clear();
+}
+
+} // namespace cheatengine
@@ -0,0 +1,536 @@
+#include "cheatengine/process/module_index.hpp"
+
+#include <mach/mach_vm.h>
+#include <mach-o/dyld_images.h>
+#include <mach-o/loader.h>
+#include <mach-o/nlist.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+constexpr std::size_t max_path_length = 1024;
+constexpr std::size_t read_page_size = 4096;
+// Slack read past the last string offset; names are not length-prefixed.
+constexpr std::uint32_t string_tail_bytes = 4096;
+constexpr const char* cache_header = "cheatengine-symbols 1";
+
+bool readRemote(task_t task, mach_vm_address_t address, std::size_t size, void* out)
+{
+    mach_vm_size_t out_size = 0;
+    const kern_return_t kr = mach_vm_read_overwrite(task,
+        address,
+        static_cast<mach_vm_size_t>(size),
+        reinterpret_cast<mach_vm_address_t>(out),
+        &out_size);
+    return kr == KERN_SUCCESS && out_size == size;
+}
+
+// Reads page by page so a short path next to an unmapped page still reads.
+bool readRemoteString(task_t task, mach_vm_address_t address, std::string& out)
+{
+    out.clear();
+    char buffer[read_page_size];
+    while (out.size() < max_path_length) {
+        const std::size_t to_page_end = read_page_size - static_cast<std::size_t>(address % read_page_size);
+        const std::size_t chunk = std::min(to_page_end, max_path_length - out.size());
+        if (!readRemote(task, address, chunk, buffer)) {
+            return false;
+        }
+        const std::size_t length = strnlen(buffer, chunk);
+        out.append(buffer, length);
+        if (length < chunk) {
+            return true;
+        }
+        address += chunk;
+    }
+    return true;
+}
+
+std::string formatUuid(const std::uint8_t* uuid)
+{
+    char text[37] = {};
+    std::snprintf(text, sizeof(text),
+                  "%02X%02X%02X%02X-%02X%02X-%02X%02X-%02X%02X-%02X%02X%02X%02X%02X%02X",
+                  uuid[0], uuid[1], uuid[2], uuid[3], uuid[4], uuid[5], uuid[6], uuid[7],
+                  uuid[8], uuid[9], uuid[10], uuid[11], uuid[12], uuid[13], uuid[14], uuid[15]);
+    return text;
+}
+
+std::string baseName(const std::string& path)
+{
+    const auto slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+std::string segmentName(const char* name)
+{
+    return std::string(name, strnlen(name, 16));
+}
+
+} // namespace
+
+namespace cheatengine {
+
+std::string ModuleIndex::Location::toString() const
+{
+    std::ostringstream oss;
+    oss << module;
+    if (!build_id.empty()) {
+        oss << '[' << build_id << ']';
+    }
+    oss << "+0x" << std::hex << offset;
+    return oss.str();
+}
+
+std::optional<ModuleIndex::Location> ModuleIndex::Location::parse(std::string_view text)
+{
+    // Module names may contain '+' themselves (libc++.1.dylib).
+    const auto plus = text.rfind('+');
+    if (plus == std::string_view::npos || plus == 0) {
+        return std::nullopt;
+    }
+
+    const std::string offset_text(text.substr(plus + 1));
+    char* end = nullptr;
+    const unsigned long long offset = std::strtoull(offset_text.c_str(), &end, 0);
+    if (offset_text.empty() || end == nullptr || *end != '\0') {
+        return std::nullopt;
+    }
+
+    Location location;
+    location.offset = offset;
+    std::string_view name = text.substr(0, plus);
+    if (name.back() == ']') {
+        const auto open = name.rfind('[');
+        if (open == std::string_view::npos || open == 0) {
+            return std::nullopt;
+        }
+        location.build_id = std::string(name.substr(open + 1, name.size() - open - 2));
+        name = name.substr(0, open);
+    }
+    location.module = std::string(name);
+    return location;
+}
+
+std::string ModuleIndex::defaultCacheDirectory()
+{
+    const char* home = std::getenv("HOME");
+    if (home == nullptr || *home == '\0') {
+        return {};
+    }
+    return std::string(home) + "/Library/Caches/cheatengine/symbols";
+}
+
+ModuleIndex::ModuleIndex()
+    : ModuleIndex(defaultCacheDirectory())
+{
+}
+
+ModuleIndex::ModuleIndex(std::string cache_directory)
+    : cache_directory_(std::move(cache_directory))
+{
+}
+
+bool ModuleIndex::build(task_t task)
+{
+    std::lock_guard<std::mutex> lock(symbols_mutex_);
+    modules_.clear();
+    layouts_.clear();
+    ranges_.clear();
+    by_name_.clear();
+    task_ = task;
+
+    if (task == MACH_PORT_NULL) {
+        return false;
+    }
+
+    task_dyld_info_data_t dyld_info{};
+    mach_msg_type_number_t count = TASK_DYLD_INFO_COUNT;
+    if (task_info(task, TASK_DYLD_INFO, reinterpret_cast<task_info_t>(&dyld_info), &count) != KERN_SUCCESS) {
+        return false;
+    }
+
+    dyld_all_image_infos infos{};
+    const auto infos_size = std::min<std::size_t>(sizeof(infos), static_cast<std::size_t>(dyld_info.all_image_info_size));
+    if (!readRemote(task, dyld_info.all_image_info_addr, infos_size, &infos)) {
+        return false;
+    }
+
+    // dyld clears infoArray while it rewrites the list.
+    if (infos.infoArray == nullptr) {
+        return false;
+    }
+
+    std::vector<dyld_image_info> images(infos.infoArrayCount);
+    if (!images.empty()
+        && !readRemote(task, reinterpret_cast<mach_vm_address_t>(infos.infoArray),
+                       images.size() * sizeof(dyld_image_info), images.data())) {
+        return false;
+    }
+
+    std::string path;
+    for (const auto& image : images) {
+        if (!readRemoteString(task, reinterpret_cast<mach_vm_address_t>(image.imageFilePath), path)) {
+            path.clear();
+        }
+        addImage(task, reinterpret_cast<mach_vm_address_t>(image.imageLoadAddress), path);
+    }
+    if (infos.dyldImageLoadAddress != nullptr) {
+        addImage(task, reinterpret_cast<mach_vm_address_t>(infos.dyldImageLoadAddress), "/usr/lib/dyld");
+    }
+
+    std::sort(ranges_.begin(), ranges_.end(), [](const Range& lhs, const Range& rhs) { return lhs.start < rhs.start; });
+    return !modules_.empty();
+}
+
+bool ModuleIndex::addImage(task_t task, mach_vm_address_t header_address, std::string path)
+{
+    mach_header_64 header{};
+    if (header_address == 0 || !readRemote(task, header_address, sizeof(header), &header)
+        || header.magic != MH_MAGIC_64) {
+        return false;
+    }
+
+    std::vector<std::uint8_t> commands(header.sizeofcmds);
+    if (!readRemote(task, header_address + sizeof(header), commands.size(), commands.data())) {
+        return false;
+    }
+
+    Module module;
+    module.name = baseName(path);
+    module.path = std::move(path);
+    module.base = header_address;
+
+    ImageLayout layout;
+    bool has_text = false;
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> segments;
+
+    std::size_t offset = 0;
+    for (std::uint32_t index = 0; index < header.ncmds; ++index) {
+        load_command command{};
+        if (offset + sizeof(command) > commands.size()) {
+            break;
+        }
+        std::memcpy(&command, commands.data() + offset, sizeof(command));
+        if (command.cmdsize < sizeof(command) || offset + command.cmdsize > commands.size()) {
+            break;
+        }
+
+        const std::uint8_t* data = commands.data() + offset;
+        if (command.cmd == LC_SEGMENT_64 && command.cmdsize >= sizeof(segment_command_64)) {
+            segment_command_64 segment{};
+            std::memcpy(&segment, data, sizeof(segment));
+            const std::string name = segmentName(segment.segname);
+            if (name == "__TEXT") {
+                layout.text_vmaddr = segment.vmaddr;
+                has_text = true;
+            }
+            if (name == "__LINKEDIT") {
+                layout.linkedit_vmaddr = segment.vmaddr;
+                layout.linkedit_fileoff = segment.fileoff;
+            } else if (name != "__PAGEZERO" && segment.vmsize != 0) {
+                segments.emplace_back(segment.vmaddr, segment.vmsize);
+            }
+        } else if (command.cmd == LC_UUID && command.cmdsize >= sizeof(uuid_command)) {
+            uuid_command uuid{};
+            std::memcpy(&uuid, data, sizeof(uuid));
+            module.build_id = formatUuid(uuid.uuid);
+        } else if (command.cmd == LC_SYMTAB && command.cmdsize >= sizeof(symtab_command)) {
+            symtab_command symtab{};
+            std::memcpy(&symtab, data, sizeof(symtab));
+            layout.symoff = symtab.symoff;
+            layout.nsyms = symtab.nsyms;
+            layout.stroff = symtab.stroff;
+            layout.strsize = symtab.strsize;
+            layout.has_symtab = true;
+        }
+
+        offset += command.cmdsize;
+    }
+
+    if (!has_text) {
+        return false;
+    }
+
+    const std::size_t module_index = modules_.size();
+    const mach_vm_address_t slide = header_address - layout.text_vmaddr;
+    for (const auto& segment : segments) {
+        const mach_vm_address_t start = segment.first + slide;
+        const mach_vm_address_t end = start + segment.second;
+        if (start >= header_address) {
+            module.size = std::max<mach_vm_size_t>(module.size, end - header_address);
+        }
+        ranges_.push_back({start, end, module_index});
+    }
+
+    by_name_.emplace(module.name, module_index);
+    modules_.push_back(std::move(module));
+    layouts_.push_back(layout);
+    return true;
+}
+
+const ModuleIndex::Module* ModuleIndex::moduleFor(mach_vm_address_t address) const
+{
+    auto it = std::upper_bound(ranges_.begin(), ranges_.end(), address,
+                               [](mach_vm_address_t value, const Range& range) { return value < range.start; });
+    if (it == ranges_.begin()) {
+        return nullptr;
+    }
+    --it;
+    return address < it->end ? &modules_[it->module] : nullptr;
+}
+
+const ModuleIndex::Module* ModuleIndex::findModule(std::string_view name, std::string_view build_id) const
+{
+    auto [first, last] = by_name_.equal_range(name);
+    for (auto it = first; it != last; ++it) {
+        const auto& module = modules_[it->second];
+        if (build_id.empty() || module.build_id == build_id) {
+            return &module;
+        }
+    }
+    return nullptr;
+}
+
+std::optional<ModuleIndex::Location> ModuleIndex::locate(mach_vm_address_t address) const
+{
+    const Module* module = moduleFor(address);
+    if (module == nullptr || address < module->base) {
+        return std::nullopt;
+    }
+    return Location{module->name, module->build_id, address - module->base};
+}
+
+std::optional<mach_vm_address_t> ModuleIndex::resolve(const Location& location) const
+{
+    const Module* module = findModule(location.module, location.build_id);
+    if (module == nullptr) {
+        return std::nullopt;
+    }
+    return module->base + location.offset;
+}
+
+std::optional<ModuleIndex::SymbolHit> ModuleIndex::symbolize(mach_vm_address_t address)
+{
+    std::lock_guard<std::mutex> lock(symbols_mutex_);
+    const Module* module = moduleFor(address);
+    if (module == nullptr || address < module->base) {
+        return std::nullopt;
+    }
+
+    const auto table = symbolsFor(static_cast<std::size_t>(module - modules_.data()));
+    const std::uint64_t offset = address - module->base;
+    auto it = std::upper_bound(table->symbols.begin(), table->symbols.end(), offset,
+                               [](std::uint64_t value, const Symbol& symbol) { return value < symbol.offset; });
+    if (it == table->symbols.begin()) {
+        return std::nullopt;
+    }
+    --it;
+    return SymbolHit{*it, offset - it->offset};
+}
+
+std::optional<mach_vm_address_t> ModuleIndex::resolveSymbol(std::string_view module_name, std::string_view symbol)
+{
+    std::lock_guard<std::mutex> lock(symbols_mutex_);
+    const Module* module = findModule(module_name);
+    if (module == nullptr) {
+        return std::nullopt;
+    }
+
+    const auto table = symbolsFor(static_cast<std::size_t>(module - modules_.data()));
+    auto it = table->by_name.find(std::string(symbol));
+    if (it == table->by_name.end()) {
+        // C symbols carry a leading underscore in Mach-O.
+        it = table->by_name.find("_" + std::string(symbol));
+    }
+    if (it == table->by_name.end()) {
+        return std::nullopt;
+    }
+    return module->base + table->symbols[it->second].offset;
+}
+
+std::shared_ptr<const ModuleIndex::SymbolTable> ModuleIndex::symbolsFor(std::size_t module)
+{
+    const auto& build_id = modules_[module].build_id;
+
+    if (!build_id.empty()) {
+        auto cached = symbol_tables_.find(build_id);
+        if (cached != symbol_tables_.end()) {
+            return cached->second;
+        }
+    }
+
+    std::shared_ptr<SymbolTable> table;
+    if (!build_id.empty()) {
+        table = loadCached(build_id);
+    }
+    if (!table) {
+        table = parseSymbols(module);
+        if (!table) {
+            // Unreadable right now; answer with nothing and retry next time
+            // rather than remembering an empty table.
+            return std::make_shared<const SymbolTable>();
+        }
+        if (!build_id.empty()) {
+            storeCached(build_id, *table);
+        }
+    }
+
+    for (std::size_t index = 0; index < table->symbols.size(); ++index) {
+        table->by_name.emplace(table->symbols[index].name, index);
+    }
+
+    if (!build_id.empty()) {
+        symbol_tables_.emplace(build_id, table);
+    }
+    return table;
+}
+
+std::shared_ptr<ModuleIndex::SymbolTable> ModuleIndex::parseSymbols(std::size_t module) const
+{
+    auto table = std::make_shared<SymbolTable>();
+    const auto& layout = layouts_[module];
+    const auto& image = modules_[module];
+    if (!layout.has_symtab || layout.nsyms == 0 || layout.strsize == 0) {
+        return table;
+    }
+
+    // Symbol and string offsets are file offsets into __LINKEDIT.
+    const mach_vm_address_t slide = image.base - layout.text_vmaddr;
+    const mach_vm_address_t linkedit = layout.linkedit_vmaddr + slide - layout.linkedit_fileoff;
+
+    std::vector<nlist_64> entries(layout.nsyms);
+    if (!readRemote(task_, linkedit + layout.symoff, entries.size() * sizeof(nlist_64), entries.data())) {
+        return nullptr;
+    }
+
+    std::uint32_t min_strx = layout.strsize;
+    std::uint32_t max_strx = 0;
+    auto defined = [&layout](const nlist_64& entry) {
+        return (entry.n_type & N_STAB) == 0 && (entry.n_type & N_TYPE) == N_SECT
+            && entry.n_un.n_strx != 0 && entry.n_un.n_strx < layout.strsize;
+    };
+    for (const auto& entry : entries) {
+        if (defined(entry)) {
+            min_strx = std::min(min_strx, entry.n_un.n_strx);
+            max_strx = std::max(max_strx, entry.n_un.n_strx);
+        }
+    }
+    if (min_strx > max_strx) {
+        return table;
+    }
+
+    // Shared-cache images index into one huge string pool; only the slice
+    // this image uses is read.
+    const std::uint32_t string_end = std::min(layout.strsize, max_strx + string_tail_bytes);
+    std::vector<char> strings(string_end - min_strx);
+    if (!readRemote(task_, linkedit + layout.stroff + min_strx, strings.size(), strings.data())) {
+        return nullptr;
+    }
+
+    for (const auto& entry : entries) {
+        if (!defined(entry) || entry.n_value < layout.text_vmaddr) {
+            continue;
+        }
+        const std::size_t start = entry.n_un.n_strx - min_strx;
+        const char* name = strings.data() + start;
+        table->symbols.push_back({std::string(name, strnlen(name, strings.size() - start)),
+                                  entry.n_value - layout.text_vmaddr,
+                                  0});
+    }
+
+    std::sort(table->symbols.begin(), table->symbols.end(),
+              [](const Symbol& lhs, const Symbol& rhs) { return lhs.offset < rhs.offset; });
+
+    // Nlist has no sizes; a symbol runs up to the next distinct address.
+    std::uint64_t next_offset = std::max<std::uint64_t>(image.size, table->symbols.empty() ? 0 : table->symbols.back().offset);
+    for (auto it = table->symbols.rbegin(); it != table->symbols.rend(); ++it) {
+        it->size = next_offset - it->offset;
+        if (std::next(it) != table->symbols.rend() && std::next(it)->offset != it->offset) {
+            next_offset = it->offset;
+        }
+    }
+    return table;
+}
+
+std::shared_ptr<ModuleIndex::SymbolTable> ModuleIndex::loadCached(const std::string& build_id) const
+{
+    if (cache_directory_.empty()) {
+        return nullptr;
+    }
+
+    std::ifstream in(cache_directory_ + "/" + build_id + ".symbols");
+    std::string line;
+    if (!in || !std::getline(in, line) || line != cache_header) {
+        return nullptr;
+    }
+
+    auto table = std::make_shared<SymbolTable>();
+    while (std::getline(in, line)) {
+        // "<offset> <size> <name>"; names may contain spaces.
+        const auto first = line.find(' ');
+        const auto second = first == std::string::npos ? first : line.find(' ', first + 1);
+        if (second == std::string::npos) {
+            return nullptr;
+        }
+        Symbol symbol;
+        symbol.offset = std::strtoull(line.c_str(), nullptr, 16);
+        symbol.size = std::strtoull(line.c_str() + first + 1, nullptr, 16);
+        symbol.name = line.substr(second + 1);
+        table->symbols.push_back(std::move(symbol));
+    }
+    return table;
+}
+
+void ModuleIndex::storeCached(const std::string& build_id, const SymbolTable& table) const
+{
+    if (cache_directory_.empty()) {
+        return;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(cache_directory_, ec);
+    if (ec) {
+        return;
+    }
+
+    // Written aside under a unique name and renamed, so a concurrent reader
+    // never sees a torn file and concurrent writers never share one.
+    const std::string path = cache_directory_ + "/" + build_id + ".symbols";
+    std::string temporary = path + ".XXXXXX";
+    const int fd = mkstemp(temporary.data());
+    if (fd < 0) {
+        return;
+    }
+    close(fd);
+    {
+        std::ofstream out(temporary, std::ios::trunc);
+        if (!out) {
+            std::filesystem::remove(temporary, ec);
+            return;
+        }
+        out << cache_header << '\n' << std::hex;
+        for (const auto& symbol : table.symbols) {
+            out << symbol.offset << ' ' << symbol.size << ' ' << symbol.name << '\n';
+        }
+        if (!out) {
+            std::filesystem::remove(temporary, ec);
+            return;
+        }
+    }
+    std::filesystem::rename(temporary, path, ec);
+    if (ec) {
+        std::filesystem::remove(temporary, ec);
+    }
+}
+
+} // namespace cheatengine
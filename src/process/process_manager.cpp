@@ -1,5 +1,7 @@
 #include "cheatengine/process/process_manager.hpp"
 
+#include "cheatengine/memory/read_engine.hpp"
+
 #include <libproc.h>        // proc_pidinfo / proc_pidpath
 #include <sys/proc_info.h>   // PROC_PIDTBSDINFO constants
 #include <unistd.h>          // getuid
@@ -88,6 +90,9 @@ bool ProcessManager::acquireTaskPort(pid_t pid, task_t& out_port)
 void ProcessManager::resetState()
 {
     if (process_.task_port != MACH_PORT_NULL) {
+        if (read_engine_ != nullptr) {
+            read_engine_->invalidate(process_.task_port);
+        }
         mach_port_deallocate(mach_task_self(), process_.task_port);
     }
     process_ = {};
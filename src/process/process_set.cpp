@@ -0,0 +1,324 @@
+#include "cheatengine/process/process_set.hpp"
+
+#include <libproc.h>
+#include <sys/proc_info.h>
+
+#include <algorithm>
+#include <optional>
+#include <tuple>
+
+namespace {
+
+using cheatengine::MemoryRegion;
+
+struct MappingKey {
+    std::uint64_t device{0};
+    std::uint64_t inode{0};
+    std::uint64_t file_offset{0};
+    mach_vm_size_t size{0};
+    vm_prot_t protection{VM_PROT_NONE};
+
+    bool operator<(const MappingKey& other) const
+    {
+        return std::tie(device, inode, file_offset, size, protection)
+            < std::tie(other.device, other.inode, other.file_offset, other.size, other.protection);
+    }
+};
+
+// Only read-only file-backed mappings that still share every page with the
+// file are safe to share: their contents are whatever the file holds at that
+// offset in every process mapping it. Read-only is not enough on its own;
+// __DATA_CONST and __AUTH_CONST are rebased and bound per process before
+// being write-protected, which leaves them copied and dirtied.
+std::optional<MappingKey> fileMappingKey(pid_t pid, const MemoryRegion& region)
+{
+    if (region.flags().writable) {
+        return std::nullopt;
+    }
+
+    const bool shared_with_file = region.share_mode == SM_SHARED
+#ifdef SM_TRUESHARED
+        || region.share_mode == SM_TRUESHARED
+#endif
+        ;
+    if (!shared_with_file || region.pages_dirtied != 0) {
+        return std::nullopt;
+    }
+
+    struct proc_regionwithpathinfo info {};
+    const int result = proc_pidinfo(pid, PROC_PIDREGIONPATHINFO, region.start_address, &info, PROC_PIDREGIONPATHINFO_SIZE);
+    if (result != PROC_PIDREGIONPATHINFO_SIZE || info.prp_vip.vip_path[0] == '\0') {
+        return std::nullopt;
+    }
+
+    const auto& native = info.prp_prinfo;
+    if (native.pri_address > region.start_address
+        || native.pri_address + native.pri_size < region.start_address + region.size) {
+        return std::nullopt;
+    }
+
+    MappingKey key;
+    key.device = info.prp_vip.vip_vi.vi_stat.vst_dev;
+    key.inode = info.prp_vip.vip_vi.vi_stat.vst_ino;
+    key.file_offset = native.pri_offset + (region.start_address - native.pri_address);
+    key.size = region.size;
+    key.protection = region.protection;
+    return key;
+}
+
+} // namespace
+
+namespace cheatengine {
+
+struct ProcessSet::Attachment {
+    explicit Attachment(const MemoryScanner& owner)
+        : scanner(owner)
+    {
+    }
+
+    ~Attachment()
+    {
+        // The port name may be reused by the next attach.
+        if (auto info = manager.currentProcess()) {
+            scanner.readEngine().invalidate(info->task_port);
+        }
+        manager.detach();
+    }
+
+    Attachment(const Attachment&) = delete;
+    Attachment& operator=(const Attachment&) = delete;
+
+    const MemoryScanner& scanner;
+    ProcessManager manager;
+};
+
+ProcessSet::ProcessSet(const MemoryScanner& scanner, ThreadPool& pool)
+    : scanner_(scanner)
+    , pool_(pool)
+{
+}
+
+ProcessSet::~ProcessSet()
+{
+    detachAll();
+}
+
+bool ProcessSet::attach(pid_t pid)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (managers_.count(pid) != 0) {
+        return true;
+    }
+
+    auto attachment = std::make_shared<Attachment>(scanner_);
+    if (!attachment->manager.attach(pid)) {
+        return false;
+    }
+    managers_.emplace(pid, std::move(attachment));
+    return true;
+}
+
+std::size_t ProcessSet::attachByPath(const std::string& executable_path)
+{
+    const int bytes_needed = proc_listpids(PROC_ALL_PIDS, 0, nullptr, 0);
+    if (bytes_needed <= 0) {
+        return 0;
+    }
+
+    std::vector<pid_t> pids(static_cast<std::size_t>(bytes_needed) / sizeof(pid_t));
+    const int bytes_filled = proc_listpids(PROC_ALL_PIDS, 0, pids.data(), static_cast<int>(pids.size() * sizeof(pid_t)));
+    if (bytes_filled <= 0) {
+        return 0;
+    }
+    pids.resize(static_cast<std::size_t>(bytes_filled) / sizeof(pid_t));
+
+    std::size_t attached = 0;
+    char path_buffer[PROC_PIDPATHINFO_MAXSIZE] = {};
+    for (pid_t pid : pids) {
+        if (pid <= 0) {
+            continue;
+        }
+
+        const int path_length = proc_pidpath(pid, path_buffer, sizeof(path_buffer));
+        if (path_length <= 0 || executable_path.compare(0, std::string::npos, path_buffer, static_cast<std::size_t>(path_length)) != 0) {
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (managers_.count(pid) != 0) {
+                continue;
+            }
+        }
+        if (attach(pid)) {
+            ++attached;
+        }
+    }
+    return attached;
+}
+
+void ProcessSet::detach(pid_t pid)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    managers_.erase(pid);
+}
+
+void ProcessSet::detachAll()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    managers_.clear();
+}
+
+std::vector<std::shared_ptr<ProcessSet::Attachment>> ProcessSet::attachments() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::shared_ptr<Attachment>> held;
+    held.reserve(managers_.size());
+    for (const auto& entry : managers_) {
+        held.push_back(entry.second);
+    }
+    return held;
+}
+
+std::vector<ProcessManager::ProcessInfo> ProcessSet::processes() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<ProcessManager::ProcessInfo> infos;
+    infos.reserve(managers_.size());
+    for (const auto& entry : managers_) {
+        if (auto info = entry.second->manager.currentProcess()) {
+            infos.push_back(*info);
+        }
+    }
+    return infos;
+}
+
+std::optional<ProcessManager::ProcessInfo> ProcessSet::find(pid_t pid) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = managers_.find(pid);
+    if (it == managers_.end()) {
+        return std::nullopt;
+    }
+    return it->second->manager.currentProcess();
+}
+
+std::size_t ProcessSet::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return managers_.size();
+}
+
+std::vector<ProcessSet::ProcessResults> ProcessSet::search(const SearchValue& value)
+{
+    // Held until the scan is done; detaching meanwhile only drops the set's
+    // reference.
+    const auto held = attachments();
+    std::vector<ProcessManager::ProcessInfo> targets;
+    targets.reserve(held.size());
+    for (const auto& attachment : held) {
+        if (auto info = attachment->manager.currentProcess()) {
+            targets.push_back(*std::move(info));
+        }
+    }
+
+    std::vector<ProcessResults> output(targets.size());
+    if (targets.empty() || value.data().empty()) {
+        return output;
+    }
+
+    // Per region: the index of the scan unit that produced its hits, and
+    // whether those hits belong to another process's identical mapping.
+    struct RegionPlan {
+        MemoryRegion region;
+        std::size_t unit{0};
+        bool aliased{false};
+    };
+    struct Unit {
+        std::size_t process{0};
+        std::size_t region{0};
+    };
+
+    std::vector<std::vector<RegionPlan>> plans(targets.size());
+    std::vector<std::vector<std::optional<MappingKey>>> keys(targets.size());
+    pool_.parallelFor(targets.size(), [&](std::size_t p) {
+        for (auto& region : scanner_.enumerate(targets[p].task_port)) {
+            if (!region.flags().readable) {
+                continue;
+            }
+            keys[p].push_back(fileMappingKey(targets[p].pid, region));
+            plans[p].push_back({std::move(region), 0, false});
+        }
+    });
+
+    std::map<MappingKey, std::size_t> owners;
+    std::vector<Unit> units;
+    std::vector<std::vector<std::size_t>> per_process_units(targets.size());
+    for (std::size_t p = 0; p < targets.size(); ++p) {
+        for (std::size_t r = 0; r < plans[p].size(); ++r) {
+            auto& plan = plans[p][r];
+            if (keys[p][r]) {
+                auto owner = owners.find(*keys[p][r]);
+                if (owner != owners.end()) {
+                    plan.unit = owner->second;
+                    plan.aliased = true;
+                    continue;
+                }
+                owners.emplace(*keys[p][r], units.size());
+            }
+            plan.unit = units.size();
+            per_process_units[p].push_back(units.size());
+            units.push_back({p, r});
+        }
+    }
+
+    // Interleave units round-robin so every process makes progress at the
+    // same rate regardless of how many regions it has.
+    std::vector<std::size_t> order;
+    order.reserve(units.size());
+    for (std::size_t depth = 0; order.size() < units.size(); ++depth) {
+        for (const auto& process_units : per_process_units) {
+            if (depth < process_units.size()) {
+                order.push_back(process_units[depth]);
+            }
+        }
+    }
+
+    std::vector<MemoryScanner::ResultList> unit_results(units.size());
+    pool_.parallelFor(order.size(), [&](std::size_t i) {
+        const Unit& unit = units[order[i]];
+        scanner_.searchRegion(targets[unit.process].task_port,
+            plans[unit.process][unit.region].region,
+            value,
+            unit_results[order[i]]);
+    });
+
+    for (std::size_t p = 0; p < targets.size(); ++p) {
+        auto& out = output[p];
+        out.pid = targets[p].pid;
+
+        for (const auto& plan : plans[p]) {
+            if (!plan.aliased) {
+                ++out.regions_scanned;
+                out.bytes_scanned += plan.region.size;
+                for (auto& hit : unit_results[plan.unit]) {
+                    out.results.push_back(hit);
+                }
+                continue;
+            }
+
+            ++out.regions_deduplicated;
+            const Unit& owner = units[plan.unit];
+            const mach_vm_address_t owner_start = plans[owner.process][owner.region].region.start_address;
+            for (const auto& hit : unit_results[plan.unit]) {
+                auto translated = hit;
+                translated.address = plan.region.start_address + (hit.address - owner_start);
+                out.results.push_back(std::move(translated));
+            }
+        }
+    }
+
+    return output;
+}
+
+} // namespace cheatengine
@@ -2,13 +2,18 @@
 
 namespace cheatengine {
 
+MemoryWriter::MemoryWriter(std::pmr::memory_resource* resource)
+    : resource_(resource)
+{
+}
+
 bool MemoryWriter::write(task_t, mach_vm_address_t address, const std::vector<std::uint8_t>& data)
 {
-    WriteOperation op;
-    op.address = address;
-    op.new_value = data;
-    op.timestamp = std::chrono::steady_clock::now();
-    op.success = false;
+    WriteOperation op{address,
+                      std::pmr::vector<std::uint8_t>(&resource_),
+                      std::pmr::vector<std::uint8_t>(data.begin(), data.end(), &resource_),
+                      std::chrono::steady_clock::now(),
+                      false};
     recordOperation(std::move(op));
     return false;
 }
@@ -21,7 +26,7 @@ bool MemoryWriter::canWrite(task_t, mach_vm_address_t, std::size_t) const
 std::vector<MemoryWriter::WriteOperation> MemoryWriter::history() const
 {
     std::lock_guard<std::mutex> lock(mutex_);
-    return history_;
+    return std::vector<WriteOperation>(history_.begin(), history_.end());
 }
 
 void MemoryWriter::recordOperation(WriteOperation operation)
@@ -0,0 +1,165 @@
+// Tests for the daemon's request parser and response writer: the strict JSON
+// number grammar, string escapes, field accessors and escaping on output.
+#include "cheatengine/daemon/protocol.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+
+namespace {
+
+using cheatengine::JsonWriter;
+using cheatengine::Request;
+
+int failures = 0;
+
+#define CHECK(condition)                                                          \
+    do {                                                                          \
+        if (!(condition)) {                                                       \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, \
+                #condition);                                                      \
+            ++failures;                                                           \
+        }                                                                         \
+    } while (false)
+
+std::optional<Request> parse(const std::string& line)
+{
+    std::string error;
+    return Request::parse(line, error);
+}
+
+// Parses {"x":<value>} and reports whether it was accepted.
+bool acceptsValue(const std::string& value)
+{
+    return parse("{\"x\":" + value + "}").has_value();
+}
+
+void testNumbers()
+{
+    for (const char* valid : {"0", "-0", "7", "-12", "1234567890", "0.5", "-0.25", "1e3", "1E-3", "2.5e+10", "-1.5e3"}) {
+        if (!acceptsValue(valid)) {
+            std::fprintf(stderr, "rejected valid number %s\n", valid);
+            ++failures;
+        }
+    }
+    for (const char* invalid : {"01", "-01", "+1", ".5", "5.", "1e", "1e+", "0x10", "nan", "NaN", "inf", "-inf",
+             "infinity", "1.5.2", "--1", "-", "1e999", "12abc", "tru", "nul"}) {
+        if (acceptsValue(invalid)) {
+            std::fprintf(stderr, "accepted invalid number %s\n", invalid);
+            ++failures;
+        }
+    }
+}
+
+void testStrings()
+{
+    const auto escapes = parse("{\"s\":\"a\\\"b\\\\c\\/d\\n\\t\\r\\u0041\\u007e\"}");
+    CHECK(escapes.has_value());
+    if (escapes) {
+        CHECK(escapes->string("s") == std::string("a\"b\\c/d\n\t\rA~"));
+    }
+
+    // Only \u00XX is decoded; anything else is refused rather than mangled.
+    CHECK(!parse(R"({"s":"\u00zz"})"));
+    CHECK(!parse("{\"s\":\"\\u0100\"}"));
+    CHECK(!parse(R"({"s":"\u00"})"));
+    CHECK(!parse(R"({"s":"\q"})"));
+    CHECK(!parse(R"({"s":"open)"));
+    CHECK(!parse(R"({"s":"trailing\)"));
+}
+
+void testStructure()
+{
+    CHECK(parse("{}").has_value());
+    CHECK(parse(" { \"a\" : 1 , \"b\" : true } ").has_value());
+    CHECK(!parse(""));
+    CHECK(!parse("[1]"));
+    CHECK(!parse("{\"a\":1"));
+    CHECK(!parse("{\"a\" 1}"));
+    CHECK(!parse("{a:1}"));
+    CHECK(!parse("{\"a\":1} x"));
+    CHECK(!parse("{\"a\":}"));
+
+    std::string error;
+    CHECK(!Request::parse("{\"x\":nan}", error));
+    CHECK(error == "unsupported value for 'x'");
+}
+
+void testAccessors()
+{
+    const auto request = parse(R"({"id":"r1","n":-42,"big":9223372036854775808,"f":1.5,"a":"0x1000","b":4096,)"
+                               R"("neg":"-1","t":true,"no":false,"nil":null})");
+    CHECK(request.has_value());
+    if (!request) {
+        return;
+    }
+
+    CHECK(request->idJson() == "\"r1\"");
+    CHECK(request->integer("n") == -42);
+    CHECK(!request->integer("big"));
+    CHECK(!request->integer("f"));
+    CHECK(!request->integer("a"));
+    CHECK(request->number("f") == 1.5);
+    CHECK(request->number("n") == -42.0);
+    CHECK(request->address("a") == 0x1000u);
+    CHECK(request->address("b") == 4096u);
+    CHECK(!request->address("neg"));
+    CHECK(!request->address("t"));
+    CHECK(request->flag("t"));
+    CHECK(!request->flag("no"));
+    CHECK(!request->flag("missing"));
+    CHECK(request->has("nil"));
+    CHECK(!request->string("nil"));
+    CHECK(!request->string("n"));
+
+    // Numeric ids are echoed verbatim; a missing id becomes null.
+    CHECK(parse("{\"id\":7}")->idJson() == "7");
+    CHECK(parse("{}")->idJson() == "null");
+}
+
+void testWriter()
+{
+    const std::string line = JsonWriter("3")
+                                 .field("s", "quote\" slash\\ nl\n ctl\x01")
+                                 .field("i", std::int64_t{-5})
+                                 .field("u", std::uint64_t{18446744073709551615ULL})
+                                 .field("b", true)
+                                 .hexField("h", 0xdeadbeef)
+                                 .rawField("r", "[1,2]")
+                                 .finish();
+    CHECK(line
+        == "{\"id\":3,\"s\":\"quote\\\" slash\\\\ nl\\n ctl\\u0001\",\"i\":-5,\"u\":18446744073709551615,"
+           "\"b\":true,\"h\":\"0xdeadbeef\",\"r\":[1,2]}\n");
+
+    // What the writer escapes, the parser reads back unchanged.
+    const std::string original = "tab\t cr\r \"q\" \\ \x1f";
+    std::string encoded = "{\"s\":";
+    cheatengine::appendJsonString(encoded, original);
+    encoded += "}";
+    const auto decoded = parse(encoded);
+    CHECK(decoded && decoded->string("s") == original);
+
+    std::string bytes;
+    const std::uint8_t data[] = {0x00, 0x0f, 0xa5, 0xff};
+    cheatengine::appendHexBytes(bytes, data, sizeof(data));
+    CHECK(bytes == "000fa5ff");
+}
+
+} // namespace
+
+int main()
+{
+    testNumbers();
+    testStrings();
+    testStructure();
+    testAccessors();
+    testWriter();
+
+    if (failures != 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::puts("protocol_test: all checks passed");
+    return 0;
+}
@@ -0,0 +1,265 @@
+// Round-trip tests for the TimeSeriesStore codec: every sample appended must
+// come back from range() bit for bit, across each delta-of-delta bucket
+// boundary, every value width, XOR window reuse and chunk rollover.
+#include "cheatengine/monitor/time_series.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace {
+
+using cheatengine::TimeSeriesStore;
+using cheatengine::ValueType;
+using Clock = TimeSeriesStore::Clock;
+
+int failures = 0;
+
+#define CHECK(condition)                                                          \
+    do {                                                                          \
+        if (!(condition)) {                                                       \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, \
+                #condition);                                                      \
+            ++failures;                                                           \
+        }                                                                         \
+    } while (false)
+
+struct Point {
+    std::int64_t micros{0};
+    std::uint64_t bits{0};
+};
+
+Clock::time_point at(std::int64_t micros)
+{
+    return Clock::time_point(std::chrono::duration_cast<Clock::duration>(std::chrono::microseconds(micros)));
+}
+
+std::uint64_t widthMask(std::size_t size)
+{
+    return size >= 8 ? ~std::uint64_t{0} : (std::uint64_t{1} << (size * 8)) - 1;
+}
+
+// Appends `points` to a fresh series and checks range() returns them as-is.
+void checkRoundTrip(const char* name, std::size_t size, const std::vector<Point>& points)
+{
+    // Keep every chunk regardless of age.
+    TimeSeriesStore store(TimeSeriesStore::Retention{std::chrono::hours(24 * 365 * 100), 0});
+    const mach_vm_address_t address = 0x1000;
+
+    for (const auto& point : points) {
+        std::uint8_t bytes[8] = {};
+        std::memcpy(bytes, &point.bits, size);
+        CHECK(store.append(address, at(point.micros), bytes, size));
+    }
+
+    // About 35 years either side of the epoch; steady_clock counts
+    // nanoseconds, so much wider bounds would overflow.
+    const auto samples = store.range(address, at(-(std::int64_t{1} << 50)), at(std::int64_t{1} << 50));
+    CHECK(samples.size() == points.size());
+
+    const std::size_t count = std::min(samples.size(), points.size());
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(samples[i].timestamp.time_since_epoch()).count();
+        if (micros != points[i].micros || samples[i].bits != (points[i].bits & widthMask(size))) {
+            std::fprintf(stderr, "%s: sample %zu decoded as (%lld, %llx), expected (%lld, %llx)\n",
+                name,
+                i,
+                static_cast<long long>(micros),
+                static_cast<unsigned long long>(samples[i].bits),
+                static_cast<long long>(points[i].micros),
+                static_cast<unsigned long long>(points[i].bits & widthMask(size)));
+            ++failures;
+            return;
+        }
+    }
+
+    const auto stats = store.stats();
+    CHECK(stats.samples == points.size());
+}
+
+void testTimestampBuckets()
+{
+    // Each dod sits on or just past a bucket edge of the encoder
+    // ([-63, 64], [-2047, 2048], [-524287, 524288], then raw 64 bits); the
+    // delta then returns to `base`, exercising the negated dod as well.
+    const std::int64_t dods[] = {0, 1, -1, 64, 65, -63, -64, 2048, 2049, -2047, -2048, 524288, 524289, -524287,
+        -524288, 1000000000000LL, -500000};
+    const std::int64_t base = 600000;
+
+    std::vector<Point> points;
+    std::int64_t time = 1000;
+    points.push_back({time, 1});
+    time += base;
+    points.push_back({time, 2});
+    for (const std::int64_t dod : dods) {
+        time += base + dod;
+        points.push_back({time, 3});
+        time += base;
+        points.push_back({time, 4});
+    }
+    checkRoundTrip("timestamp buckets", 8, points);
+
+    // Repeated timestamps (delta 0) and a return to a steady rate.
+    std::vector<Point> repeated;
+    for (int i = 0; i < 10; ++i) {
+        repeated.push_back({5000, static_cast<std::uint64_t>(i)});
+    }
+    for (int i = 0; i < 10; ++i) {
+        repeated.push_back({5000 + (i + 1) * 100000, static_cast<std::uint64_t>(i)});
+    }
+    checkRoundTrip("repeated timestamps", 4, repeated);
+
+    // Timestamps before the clock's epoch.
+    checkRoundTrip("negative timestamps", 8, {{-3000000, 7}, {-2000000, 7}, {-1, 8}, {0, 9}, {5, 9}});
+}
+
+void testValueEdges()
+{
+    const std::uint64_t patterns[] = {
+        0,
+        ~std::uint64_t{0},
+        0,
+        1,
+        std::uint64_t{1} << 63,
+        0x5555555555555555ULL,
+        0xAAAAAAAAAAAAAAAAULL,
+        0xAAAAAAAAAAAAAAAAULL,
+        0x8000000000000001ULL,
+        0x00000000FFFFFFFFULL,
+        0xFFFFFFFF00000000ULL,
+        0x0000000000000100ULL,
+        0x0000000000000300ULL, // fits the previous XOR window
+        0x0123456789ABCDEFULL,
+        0,
+    };
+
+    for (const std::size_t size : {std::size_t{1}, std::size_t{2}, std::size_t{4}, std::size_t{8}}) {
+        std::vector<Point> points;
+        std::int64_t time = 1;
+        for (const std::uint64_t bits : patterns) {
+            points.push_back({time, bits & widthMask(size)});
+            time += 1000;
+        }
+        char name[32];
+        std::snprintf(name, sizeof(name), "value edges, size %zu", size);
+        checkRoundTrip(name, size, points);
+    }
+
+    // IEEE special values stored as raw bits.
+    std::vector<Point> floats;
+    const double specials[] = {0.0, -0.0, std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(),
+        std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::denorm_min(), 1.5, -1.5};
+    std::int64_t time = 0;
+    for (const double value : specials) {
+        std::uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        floats.push_back({time, bits});
+        time += 16667;
+    }
+    checkRoundTrip("double specials", 8, floats);
+}
+
+void testChunkRollover()
+{
+    // Pseudo-random values and jittered timestamps defeat both compressors,
+    // so this spans many chunks.
+    std::vector<Point> points;
+    std::uint64_t state = 0x9E3779B97F4A7C15ULL;
+    std::int64_t time = 0;
+    for (int i = 0; i < 50000; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        time += 1000 + static_cast<std::int64_t>(state % 5000);
+        points.push_back({time, state});
+    }
+    checkRoundTrip("chunk rollover", 8, points);
+}
+
+void testRejection()
+{
+    TimeSeriesStore store;
+    const mach_vm_address_t address = 0x2000;
+    const std::uint8_t bytes[8] = {42};
+
+    CHECK(store.append(address, at(2000), bytes, 4));
+    CHECK(!store.append(address, at(1999), bytes, 4));
+    CHECK(store.append(address, at(2000), bytes, 4));
+    CHECK(!store.append(address, at(3000), bytes, 8));
+    CHECK(!store.append(address, at(3000), bytes, 3));
+    CHECK(store.range(address, at(0), at(10000)).size() == 2);
+}
+
+void testRangeAndDownsample()
+{
+    TimeSeriesStore store;
+    const mach_vm_address_t address = 0x3000;
+    CHECK(store.addSeries(address, ValueType::INT32));
+    for (std::int32_t i = 0; i < 10; ++i) {
+        const std::int32_t value = -i;
+        CHECK(store.append(address, at(i * 1000), reinterpret_cast<const std::uint8_t*>(&value), sizeof(value)));
+    }
+
+    // Both ends are inclusive.
+    const auto middle = store.range(address, at(3000), at(6000));
+    CHECK(middle.size() == 4);
+
+    const auto buckets = store.downsample(address, at(0), at(9000), std::chrono::microseconds(5000));
+    CHECK(buckets.size() == 2);
+    if (buckets.size() == 2) {
+        CHECK(buckets[0].count == 5);
+        CHECK(buckets[0].min == -4.0);
+        CHECK(buckets[0].max == 0.0);
+        CHECK(buckets[0].mean == -2.0);
+        CHECK(buckets[1].last == -9.0);
+    }
+
+    CHECK(TimeSeriesStore::toDouble(ValueType::INT32, 4, 0xFFFFFFFFULL) == -1.0);
+    CHECK(TimeSeriesStore::toDouble(ValueType::INT64, 1, 0x80) == -128.0);
+    const float half = 0.5f;
+    std::uint32_t half_bits = 0;
+    std::memcpy(&half_bits, &half, sizeof(half));
+    CHECK(TimeSeriesStore::toDouble(ValueType::FLOAT32, 4, half_bits) == 0.5);
+}
+
+void testRetention()
+{
+    TimeSeriesStore store(TimeSeriesStore::Retention{std::chrono::hours(1), 2});
+    const mach_vm_address_t address = 0x4000;
+    std::uint64_t state = 1;
+    std::int64_t time = 0;
+    for (int i = 0; i < 5000; ++i) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        time += 997;
+        store.append(address, at(time), reinterpret_cast<const std::uint8_t*>(&state), sizeof(state));
+    }
+
+    const auto stats = store.stats();
+    CHECK(stats.chunks <= 2);
+    const auto kept = store.range(address, at(0), at(time));
+    CHECK(!kept.empty());
+    CHECK(kept.size() == stats.samples);
+    CHECK(std::chrono::duration_cast<std::chrono::microseconds>(kept.back().timestamp.time_since_epoch()).count() == time);
+    CHECK(kept.back().bits == state);
+}
+
+} // namespace
+
+int main()
+{
+    testTimestampBuckets();
+    testValueEdges();
+    testChunkRollover();
+    testRejection();
+    testRangeAndDownsample();
+    testRetention();
+
+    if (failures != 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::puts("time_series_test: all checks passed");
+    return 0;
+}